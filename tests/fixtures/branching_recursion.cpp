@@ -0,0 +1,35 @@
+// Recursion that branches on a smaller argument is exponential, and a
+// branch count that shrinks with the depth is factorial
+#include <vector>
+
+// expect fib O(2^n)
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);  // line O(2^n)
+}
+
+// expect trib O(3^n)
+int trib(int n) {
+    if (n < 3) return n;
+    return trib(n - 1) + trib(n - 2) + trib(n - 3);
+}
+
+// expect subsets O(2^k)
+void subsets(std::vector<int>& a, int k) {
+    if (k == 0) return;
+    subsets(a, k - 1);
+    subsets(a, k - 1);
+}
+
+// expect arrangements O(n!)
+int arrangements(std::vector<bool>& used, int n, int placed) {
+    if (placed == n) return 1;
+    int total = 0;
+    for (int i = 0; i < n; i++) {
+        if (used[i]) continue;
+        used[i] = true;
+        total += arrangements(used, n, placed + 1);
+        used[i] = false;
+    }
+    return total;
+}
@@ -0,0 +1,28 @@
+// A call costs what its callee costs, through any number of calls
+#include <vector>
+
+// expect inner O(v)
+int inner(const std::vector<int>& v) {
+    int s = 0;
+    for (int x : v) s += x;
+    return s;
+}
+
+// expect middle O(v)
+int middle(const std::vector<int>& v) {
+    return inner(v) + 1;  // line O(v)
+}
+
+// expect outer O(v²)
+int outer(const std::vector<int>& v) {
+    int s = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        s += middle(v);  // line O(v²)
+    }
+    return s;
+}
+
+// expect twice O(v)
+int twice(const std::vector<int>& v) {
+    return inner(v) + inner(v);
+}
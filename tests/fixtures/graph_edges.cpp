@@ -0,0 +1,48 @@
+// Walking every adjacency list visits each edge once: O(V + E), not O(V²)
+#include <vector>
+
+// expect edges_of O(adj + |adj|)
+int edges_of(const std::vector<std::vector<int>>& adj) {
+    int count = 0;
+    for (auto& list : adj) {
+        for (int v : list) {  // line O(|adj|)
+            count += v;
+        }
+    }
+    return count;
+}
+
+// expect neighbours O(adj + |adj|)
+int neighbours(const std::vector<std::vector<int>>& adj) {
+    int count = 0;
+    for (size_t u = 0; u < adj.size(); u++) {
+        for (size_t i = 0; i < adj[u].size(); i++) {
+            count += adj[u][i];
+        }
+    }
+    return count;
+}
+
+// An index bounded by an outer index is still triangular
+// expect pairs O(n²)
+int pairs(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {  // line O(n²)
+            s++;
+        }
+    }
+    return s;
+}
+
+// Two independent sizes multiply
+// expect grid O(rows·cols)
+int grid(int rows, int cols) {
+    int s = 0;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            s += r * c;
+        }
+    }
+    return s;
+}
@@ -0,0 +1,25 @@
+// Containers constructed with a size cost one step per element
+#include <vector>
+
+// expect scratch O(n²)
+// expect-space scratch O(n)
+int scratch(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        std::vector<int> w(n);  // finding loop-allocation  // line O(n²)
+        s += w[i];
+    }
+    return s;
+}
+
+// expect copy_of O(v)
+std::vector<int> copy_of(const std::vector<int>& v) {
+    std::vector<int> out(v.begin(), v.end());  // line O(v)
+    return out;
+}
+
+// expect grid O(rows·cols)
+int grid(int rows, int cols) {
+    std::vector<std::vector<int>> g(rows, std::vector<int>(cols));  // line O(rows·cols)
+    return g.size();
+}
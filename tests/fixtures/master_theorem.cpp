@@ -0,0 +1,44 @@
+// Divide-and-conquer recursions are solved with the Master theorem
+#include <vector>
+
+// Two halves and a linear merge: case 2
+// expect merge_sort O(n log n)
+void merge_sort(std::vector<int>& a, int lo, int hi) {
+    if (hi - lo < 2) return;
+    int mid = (lo + hi) / 2;
+    merge_sort(a, lo, mid);  // line O(n log n)
+    merge_sort(a, mid, hi);
+    std::vector<int> merged;
+    int i = lo, j = mid;
+    while (i < mid || j < hi) {
+        if (j >= hi || (i < mid && a[i] <= a[j])) merged.push_back(a[i++]);
+        else merged.push_back(a[j++]);
+    }
+    for (int k = lo; k < hi; k++) {
+        a[k] = merged[k - lo];
+    }
+}
+
+// One half and constant work: case 2
+// expect search O(log n)
+int search(const std::vector<int>& a, int lo, int hi, int x) {
+    if (lo >= hi) return -1;
+    int mid = (lo + hi) / 2;
+    if (a[mid] == x) return mid;
+    if (a[mid] < x) return search(a, mid + 1, hi, x);
+    return search(a, lo, mid, x);
+}
+
+// Two halves and constant work: case 1
+// expect count_nodes O(n)
+int count_nodes(int n) {
+    if (n <= 1) return 1;
+    return count_nodes(n / 2) + count_nodes(n / 2) + 1;
+}
+
+// A self-call one smaller: linear recursion
+// expect depth O(n)
+int depth(int n) {
+    if (n == 0) return 0;
+    return depth(n - 1) + 1;
+}
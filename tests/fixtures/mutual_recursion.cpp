@@ -0,0 +1,36 @@
+// Functions in one strongly connected component of the call graph are
+// solved together
+
+bool is_odd(int n);
+
+// expect is_even O(n)
+bool is_even(int n) {
+    if (n == 0) return true;
+    return is_odd(n - 1);  // line O(n)
+}
+
+// expect is_odd O(n)
+bool is_odd(int n) {
+    if (n == 0) return false;
+    return is_even(n - 1);
+}
+
+int third(int n);
+
+// expect first O(n)
+int first(int n) {
+    if (n <= 0) return 0;
+    return second(n - 1);
+}
+
+// expect second O(n)
+int second(int n) {
+    if (n <= 0) return 0;
+    return third(n - 1);
+}
+
+// expect third O(n)
+int third(int n) {
+    if (n <= 0) return 0;
+    return first(n - 1);
+}
@@ -0,0 +1,28 @@
+// Parallel loops and algorithms report their work and critical path
+#include <algorithm>
+#include <execution>
+#include <vector>
+
+// expect scale O(n)
+void scale(std::vector<double>& v, int n) {
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {  // reason work O(n), span O(log n), parallelism O(n / log n)
+        v[i] = v[i] * 2;
+    }
+}
+
+// Only the outer loop is split, so each row is a serial O(n) step
+// expect rows O(n²)
+void rows(std::vector<std::vector<int>>& g, int n) {
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {  // reason work O(n²), span O(n), parallelism O(n)
+        for (int j = 0; j < n; j++) {
+            g[i][j] = i + j;
+        }
+    }
+}
+
+// expect sort_all O(v log v)
+void sort_all(std::vector<int>& v) {
+    std::sort(std::execution::par, v.begin(), v.end());  // reason in parallel with span O(log² v)
+}
@@ -0,0 +1,30 @@
+// A self-call passing param + c shrinks only towards a size the parameter
+// is checked against
+#include <vector>
+
+// expect sum O(n)
+int sum(const std::vector<int>& v, int i, int n) {
+    if (i >= n) return 0;
+    return v[i] + sum(v, i + 1, n);
+}
+
+// expect permute O(a!)
+void permute(std::vector<int>& a, int k) {
+    if (k == a.size()) return;
+    for (int i = k; i < a.size(); i++) {
+        permute(a, k + 1);
+    }
+}
+
+// A depth counter with a constant limit says nothing about the input
+// expect-unknown Parser::value
+struct Parser {
+    bool value(int depth) {
+        if (depth > 64) return false;
+        while (more()) {
+            if (!value(depth + 1)) return false;
+        }
+        return true;
+    }
+    bool more();
+};
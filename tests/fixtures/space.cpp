@@ -0,0 +1,39 @@
+// Auxiliary space: sized containers, growth inside loops and the
+// recursion stack
+#include <vector>
+
+// expect-space table O(n²)
+std::vector<std::vector<int>> table(int n) {
+    std::vector<std::vector<int>> t(n, std::vector<int>(n));
+    return t;
+}
+
+// expect-space squares O(n)
+std::vector<int> squares(int n) {
+    std::vector<int> out;
+    for (int i = 0; i < n; i++) {
+        out.push_back(i * i);
+    }
+    return out;
+}
+
+// expect-space depth O(n)
+int depth(int n) {
+    if (n == 0) return 0;
+    return depth(n - 1) + 1;
+}
+
+// expect-space search O(log n)
+int search(const std::vector<int>& a, int lo, int hi, int x) {
+    if (lo >= hi) return -1;
+    int mid = (lo + hi) / 2;
+    if (a[mid] < x) return search(a, mid + 1, hi, x);
+    return search(a, lo, mid, x);
+}
+
+// expect-space total O(1)
+int total(const std::vector<int>& v) {
+    int s = 0;
+    for (int x : v) s += x;
+    return s;
+}
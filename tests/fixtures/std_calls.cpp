@@ -0,0 +1,38 @@
+// Standard library calls cost what the built-in table says, on the
+// container they are called on
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// expect sort_each O(rows·r log r)
+void sort_each(std::vector<std::vector<int>>& rows) {
+    for (auto& r : rows) {
+        std::sort(r.begin(), r.end());  // line O(rows·r log r)
+    }
+}
+
+// expect lookups O(keys log m)
+int lookups(const std::map<std::string, int>& m, const std::vector<std::string>& keys) {
+    int s = 0;
+    for (const auto& k : keys) {
+        s += m.find(k)->second;  // line O(keys log m)
+    }
+    return s;
+}
+
+// expect contains_all O(keys·v)
+bool contains_all(const std::vector<int>& v, const std::vector<int>& keys) {
+    for (int k : keys) {
+        if (std::find(v.begin(), v.end(), k) == v.end()) return false;  // finding hidden-quadratic
+    }
+    return true;
+}
+
+// push_back is amortized O(1)
+// expect fill O(n)
+void fill(std::vector<int>& out, int n) {
+    for (int i = 0; i < n; i++) {
+        out.push_back(i);
+    }
+}
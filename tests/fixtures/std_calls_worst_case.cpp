@@ -0,0 +1,10 @@
+// --worst-case costs a push_back that reallocates
+// options: --worst-case
+#include <vector>
+
+// expect fill O(n·out)
+void fill(std::vector<int>& out, int n) {
+    for (int i = 0; i < n; i++) {
+        out.push_back(i);  // line O(n·out)
+    }
+}
@@ -0,0 +1,33 @@
+// An innermost loop should walk the last subscript of a row-major array
+#include <vector>
+
+// expect column_sum O(n²)
+long column_sum(const std::vector<std::vector<int>>& g, int n) {
+    long s = 0;
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            s += g[i][j];  // finding strided-access
+        }
+    }
+    return s;
+}
+
+// expect row_sum O(n²)
+long row_sum(const std::vector<std::vector<int>>& g, int n) {
+    long s = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            s += g[i][j];  // no-finding strided-access
+        }
+    }
+    return s;
+}
+
+// expect transpose O(n²)
+void transpose(int a[][64], int b[][64], int n) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            b[j][i] = a[i][j];  // finding strided-access
+        }
+    }
+}
@@ -0,0 +1,20 @@
+// Rebuilding a string with + copies it, so the copy is part of the line cost
+#include <string>
+
+// expect join O(n·s)
+std::string join(int n, const std::string& x) {
+    std::string s;
+    for (int i = 0; i < n; i++) {
+        s = s + x;  // finding hidden-quadratic  // line O(n·s)
+    }
+    return s;
+}
+
+// expect append O(n)
+std::string append(int n, const std::string& x) {
+    std::string s;
+    for (int i = 0; i < n; i++) {
+        s += x;  // no-finding hidden-quadratic
+    }
+    return s;
+}
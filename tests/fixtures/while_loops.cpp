@@ -0,0 +1,50 @@
+// Condition-driven while loops: bisection, queue drains and plain counters
+#include <queue>
+#include <vector>
+
+// expect find O(log v)
+int find(const std::vector<int>& v, int x) {
+    int lo = 0, hi = v.size() - 1;
+    while (lo <= hi) {  // line O(log v)
+        int mid = lo + (hi - lo) / 2;
+        if (v[mid] == x) return mid;
+        if (v[mid] < x) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+// expect lower_bound_of O(log n)
+int lower_bound_of(const int* a, int n, int x) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (a[mid] < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Each vertex is popped once, so the edge loop adds up to |adj|
+// expect bfs O(q + |adj|)
+void bfs(const std::vector<std::vector<int>>& adj, int s) {
+    std::queue<int> q;
+    q.push(s);
+    while (!q.empty()) {  // line O(q)
+        int u = q.front();
+        q.pop();
+        for (int v : adj[u]) {  // line O(|adj|)
+            q.push(v);
+        }
+    }
+}
+
+// expect count_up O(n)
+int count_up(int n) {
+    int i = 0, s = 0;
+    while (i < n) {
+        s += i;
+        i++;
+    }
+    return s;
+}
@@ -0,0 +1,527 @@
+#!/usr/bin/env python3
+"""Regression tests for the time complexity analyzer.
+
+Usage: run_tests.py PATH_TO_TIME_BINARY [NAME_FILTER]
+
+Every fixtures/*.cpp file is analyzed with --format json and checked
+against the expectations written in its comments:
+
+    // expect NAME O(...)          function NAME costs O(...)
+    // expect-space NAME O(...)    function NAME needs O(...) auxiliary space
+    // expect-unknown NAME         function NAME has no solved cost
+    // options: ARG...             extra command line arguments
+    code;  // line O(...)          this line costs O(...)
+    code;  // reason TEXT          the reason given for this line contains TEXT
+    code;  // finding RULE         a RULE finding is reported on this line
+    code;  // no-finding RULE      no RULE finding is reported on this line
+
+The scenarios below cover the modes that are not a single analysis:
+baselines, the index, the history store, diffs and the protocols.
+"""
+
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FIXTURES = os.path.join(HERE, "fixtures")
+COLORS = re.compile(r"\x1b\[[0-9;]*m")
+
+failures = []
+
+
+def check(condition, name, message):
+    if not condition:
+        failures.append(f"{name}: {message}")
+    return condition
+
+
+def run(tool, args, stdin=None, cwd=None):
+    return subprocess.run([tool] + args, input=stdin, cwd=cwd, capture_output=True, timeout=120)
+
+
+def check_fixture(tool, path):
+    name = os.path.basename(path)
+    with open(path, encoding="utf-8") as f:
+        source = f.read().splitlines()
+    options = []
+    functions, spaces, unknown, lines, reasons, findings, no_findings = {}, {}, [], {}, {}, [], []
+    for number, text in enumerate(source, 1):
+        m = re.search(r"//\s*expect\s+(\S+)\s+(O\(.*\))\s*$", text)
+        if m:
+            functions[m.group(1)] = m.group(2)
+        m = re.search(r"//\s*expect-space\s+(\S+)\s+(O\(.*\))\s*$", text)
+        if m:
+            spaces[m.group(1)] = m.group(2)
+        m = re.search(r"//\s*expect-unknown\s+(\S+)\s*$", text)
+        if m:
+            unknown.append(m.group(1))
+        m = re.search(r"//\s*options:\s*(.*)$", text)
+        if m:
+            options += m.group(1).split()
+        m = re.search(r"\S.*//\s*line\s+(O\(.*\))\s*$", text)
+        if m:
+            lines[number] = m.group(1)
+        m = re.search(r"\S.*//\s*reason\s+(.*?)\s*$", text)
+        if m:
+            reasons[number] = m.group(1)
+        for rule in re.findall(r"//\s*finding\s+([\w-]+)", text):
+            findings.append((number, rule))
+        for rule in re.findall(r"//\s*no-finding\s+([\w-]+)", text):
+            no_findings.append((number, rule))
+
+    result = run(tool, options + ["--format", "json", path])
+    if not check(result.returncode == 0, name, f"exit status {result.returncode}: {result.stderr.decode()}"):
+        return
+    report = json.loads(result.stdout)["files"][0]
+    costs = {fn["name"]: fn for fn in report["functions"]}
+    for fn, expected in functions.items():
+        actual = costs.get(fn, {}).get("cost")
+        check(actual == expected, name, f"{fn} is {actual}, expected {expected}")
+    for fn, expected in spaces.items():
+        actual = costs.get(fn, {}).get("space")
+        check(actual == expected, name, f"{fn} needs {actual} space, expected {expected}")
+    for fn in unknown:
+        actual = costs.get(fn, {}).get("cost")
+        check(actual == "unknown", name, f"{fn} is {actual}, expected unknown")
+    line_costs = {entry["line"]: entry["cost"] for entry in report["lines"]}
+    for number, expected in lines.items():
+        actual = line_costs.get(number, "O(1)")
+        check(actual == expected, name, f"line {number} is {actual}, expected {expected}")
+    line_reasons = {entry["line"]: entry["reason"] for entry in report["lines"]}
+    for number, expected in reasons.items():
+        actual = line_reasons.get(number, "")
+        check(expected in actual, name, f"line {number} gives {actual!r}, expected {expected!r}")
+    reported = {(f["line"], f["rule"]) for f in report["findings"]}
+    for number, rule in findings:
+        check((number, rule) in reported, name, f"no {rule} finding on line {number}")
+    for number, rule in no_findings:
+        check((number, rule) not in reported, name, f"unexpected {rule} finding on line {number}")
+
+
+SCENARIOS = []
+
+
+def scenario(function):
+    SCENARIOS.append(function)
+    return function
+
+
+@scenario
+def test_daemon(tool, work):
+    """The daemon answers a client while another holds its input open"""
+    if os.name == "nt":
+        return
+    source = os.path.join(work, "a.cpp")
+    with open(source, "w") as f:
+        f.write("int f(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) {\n        s += i;\n    }\n    return s;\n}\n")
+    socket = os.path.join(work, "s.sock")
+    server = subprocess.Popen([tool, "--serve", socket], stderr=subprocess.DEVNULL)
+    idle = None
+    try:
+        for _ in range(50):
+            if os.path.exists(socket):
+                break
+            time.sleep(0.1)
+        idle = subprocess.Popen([tool, "--connect", socket, "--ndjson"], stdin=subprocess.PIPE, stdout=subprocess.DEVNULL)
+        time.sleep(0.5)
+        start = time.time()
+        result = run(tool, ["--connect", socket, "--format", "json", source])
+        check(result.returncode == 0, "test_daemon", f"exit status {result.returncode}")
+        check(json.loads(result.stdout)["files"][0]["functions"][0]["cost"] == "O(n)", "test_daemon", "wrong cost")
+        check(time.time() - start < 60, "test_daemon", "second client waited on the idle one")
+    finally:
+        if idle:
+            idle.kill()
+        server.kill()
+        server.wait()
+
+
+def write_files(root, files):
+    for name, text in files.items():
+        path = os.path.join(root, name)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "w") as f:
+            f.write(text)
+
+
+def function_costs(output):
+    return {(f["file"].replace("\\", "/"), fn["name"]): fn["cost"] for f in json.loads(output)["files"] for fn in f["functions"]}
+
+
+@scenario
+def test_summaries(tool, work):
+    """A function summary follows the worst path through its callees and lists its callers"""
+    with open(os.path.join(FIXTURES, "call_costs.cpp"), "rb") as f:
+        result = run(tool, [], stdin=f.read() + b"\nEND\n")
+    output = COLORS.sub("", result.stdout.decode())
+    summaries = output[output.find("Function Summaries:"):]
+    outer = summaries[summaries.find("outer (lines"):summaries.find("twice (lines")]
+    check(outer.startswith("outer (lines 17-23): O(v²)"), "test_summaries", f"outer summary is {outer!r}")
+    path = [line.strip() for line in outer.splitlines() if line.strip().startswith("->")]
+    check([step.split(":")[0] for step in path] == ["-> line 19", "-> line 20", "-> middle line 13", "-> inner line 7"],
+          "test_summaries", f"worst path of outer is {path}")
+    check("Called by: middle, twice" in summaries, "test_summaries", "inner does not list its callers")
+
+
+EXPONENTIAL = "int subsets(int n) {\n    if (n == 0) return 1;\n    return subsets(n - 1) + subsets(n - 1);\n}\n"
+FACTORIAL = ("int orders(int n, int k) {\n    if (k == n) return 1;\n    int s = 0;\n    for (int i = k; i < n; i++) {\n"
+             "        s += orders(n, k + 1);\n    }\n    return s;\n}\n")
+QUADRATIC = "int pairs(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) {\n        for (int j = 0; j < n; j++) {\n            s++;\n        }\n    }\n    return s;\n}\n"
+LINEAR = "int total(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) {\n        s += i;\n    }\n    return s;\n}\n"
+
+
+@scenario
+def test_top(tool, work):
+    """--top ranks the hottest functions and loop nests across the tree, fastest growth first"""
+    write_files(work, {"src/a.cpp": LINEAR, "src/b.cpp": QUADRATIC, "src/deep/c.cpp": EXPONENTIAL, "src/d.cpp": FACTORIAL})
+    result = run(tool, ["--top", "4", "src"], cwd=work)
+    ranked = [line.split()[1:3] for line in COLORS.sub("", result.stdout.decode()).splitlines() if re.match(r"\s*\d+\. ", line)]
+    expected = [["O(n!)", "src/d.cpp:1-8"], ["O(n!)", "src/d.cpp:4-6"], ["O(2^n)", "src/deep/c.cpp:1-4"], ["O(n²)", "src/b.cpp:1-9"]]
+    check(ranked == expected, "test_top", f"ranked {ranked}")
+
+
+@scenario
+def test_baseline(tool, work):
+    """A baseline comparison fails on a class regression, even between two exponential classes"""
+    write_files(work, {"src/a.cpp": LINEAR, "src/b.cpp": EXPONENTIAL.replace("subsets", "search")})
+    baseline = os.path.join(work, "baseline.txt")
+    check(run(tool, ["--write-baseline", baseline, "src"], cwd=work).returncode == 0, "test_baseline", "cannot write the baseline")
+    check(run(tool, ["--baseline", baseline, "src"], cwd=work).returncode == 0, "test_baseline", "an unchanged tree regressed")
+    write_files(work, {"src/b.cpp": FACTORIAL.replace("orders", "search")})
+    result = run(tool, ["--baseline", baseline, "src"], cwd=work)
+    output = COLORS.sub("", result.stdout.decode())
+    check(result.returncode == 1, "test_baseline", f"2^n to n! exited with {result.returncode}")
+    check("search: O(2^n) -> O(n!)" in output, "test_baseline", f"regression report is {output!r}")
+    write_files(work, {"src/b.cpp": QUADRATIC.replace("pairs", "search")})
+    result = run(tool, ["--baseline", baseline, "src"], cwd=work)
+    check(result.returncode == 0 and "Improvements (1)" in COLORS.sub("", result.stdout.decode()), "test_baseline", "2^n to n² is not an improvement")
+
+
+@scenario
+def test_ndjson(tool, work):
+    """Batch mode answers every request line by id, malformed ones included"""
+    requests = [{"id": i, "source": LINEAR if i % 2 else QUADRATIC} for i in range(40)]
+    requests.append({"id": "worst", "source": "void f(std::vector<int>& v, int n) {\n    for (int i = 0; i < n; i++) {\n"
+                     "        v.push_back(i);\n    }\n}\n", "options": {"worst_case": True}})
+    stdin = "".join(json.dumps(request) + "\n" for request in requests) + "\n{not json\n"
+    result = run(tool, ["--ndjson"], stdin=stdin.encode())
+    answers = [json.loads(line) for line in result.stdout.decode().splitlines()]
+    by_id = {answer["id"]: answer for answer in answers}
+    check(len(answers) == len(requests) + 1, "test_ndjson", f"{len(answers)} answers to {len(requests) + 1} requests")
+    check(all(by_id.get(i, {}).get("complexity") == ("O(n)" if i % 2 else "O(n²)") for i in range(40)), "test_ndjson", "wrong or missing answers")
+    check(by_id.get("worst", {}).get("complexity") == "O(n·v)", "test_ndjson", f"worst case option gave {by_id.get('worst')}")
+    check(by_id.get(None, {}).get("error") == "malformed request", "test_ndjson", "no error for a malformed line")
+
+
+def read_varint(data, pos):
+    value, shift = 0, 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, pos
+
+
+def decode_binary(data):
+    """Records of a compact binary report as (tag, fields) with strings and line numbers resolved"""
+    fields_of = {1: "s", 2: "slvvss", 3: "lvss", 4: "lvvsss", 5: "ss", 6: "s"}
+    check(data[:4] == b"TCB1", "decode_binary", "missing magic")
+    records, pos, strings, line = [], 4, [], 0
+    while pos < len(data):
+        tag = data[pos]
+        pos += 1
+        if tag == 1:
+            strings, line = [], 0
+        fields = []
+        for kind in fields_of[tag]:
+            value, pos = read_varint(data, pos)
+            if kind == "s":
+                if value == 0:
+                    length, pos = read_varint(data, pos)
+                    strings.append(data[pos:pos + length].decode())
+                    pos += length
+                    value = strings[-1]
+                else:
+                    value = strings[value - 1]
+            elif kind == "l":
+                line += (value >> 1) ^ -(value & 1)
+                value = line
+            fields.append(value)
+        records.append((tag, fields))
+    return records
+
+
+@scenario
+def test_formats(tool, work):
+    """JSON, SARIF and binary reports agree and each marks an unreadable file"""
+    shutil.copy(os.path.join(FIXTURES, "call_costs.cpp"), work)
+    write_files(work, {"locked.cpp": LINEAR})
+    os.chmod(os.path.join(work, "locked.cpp"), 0)
+    os.chmod(work, 0o755)
+    # root reads any file, so the reports are written as nobody
+    user = {"user": 65534} if hasattr(os, "geteuid") and os.geteuid() == 0 else {}
+    reports = {}
+    for name in ("json", "sarif", "binary"):
+        result = subprocess.run([tool, "--format", name, "call_costs.cpp", "locked.cpp"], cwd=work, capture_output=True, timeout=120, **user)
+        check(result.returncode == 0, "test_formats", f"--format {name} exited with {result.returncode}")
+        reports[name] = result.stdout
+    files = json.loads(reports["json"])["files"]
+    costs = {fn["name"]: fn["cost"] for fn in files[0]["functions"]}
+    check(costs == {"inner": "O(v)", "middle": "O(v)", "outer": "O(v²)", "twice": "O(v)"}, "test_formats", f"json costs {costs}")
+    check(len(files) == 2 and "error" in files[1], "test_formats", "json has no error entry for the unreadable file")
+    sarif = json.loads(reports["sarif"])
+    results = sarif["runs"][0]["results"]
+    check(sarif["version"] == "2.1.0", "test_formats", "not a SARIF 2.1.0 log")
+    check(any(r["ruleId"] == "unreadable-file" and r["level"] == "error" for r in results), "test_formats", "sarif has no unreadable-file result")
+    records = decode_binary(reports["binary"])
+    functions = {fields[0]: fields[4] for tag, fields in records if tag == 2}
+    check(functions == costs, "test_formats", f"binary costs {functions}")
+    check([fields[1] for tag, fields in records if tag == 2] == [fn["first_line"] for fn in files[0]["functions"]],
+          "test_formats", "binary line numbers differ from json")
+    check([tag for tag, _ in records][-2:] == [1, 6], "test_formats", "binary has no unreadable record for the last file")
+
+
+@scenario
+def test_history(tool, work):
+    """The history store records each commit's costs and survives a run cut short"""
+    store = os.path.join(work, "store.hist")
+    for commit, source in (("c1", LINEAR), ("c2", QUADRATIC.replace("pairs", "total"))):
+        write_files(work, {"a.cpp": source})
+        result = run(tool, ["--append-history", store, "--commit", commit, "a.cpp"], cwd=work)
+        check(result.returncode == 0, "test_history", f"recording {commit} exited with {result.returncode}")
+    series = COLORS.sub("", run(tool, ["--history", store, "--function", "total"], cwd=work).stdout.decode()).splitlines()
+    check([line.split() for line in series] == [["c1", "a.cpp:", "total", "O(n)"], ["c2", "a.cpp:", "total", "O(n²)"]], "test_history", f"series is {series}")
+    changed = COLORS.sub("", run(tool, ["--history", store, "--changed", "c1", "c2"], cwd=work).stdout.decode())
+    check("a.cpp: total  O(n) -> O(n²)" in changed, "test_history", f"changes are {changed!r}")
+    check(run(tool, ["--history", store, "--function", "missing"], cwd=work).returncode == 1, "test_history", "found a missing function")
+
+    write_files(work, {"a.cpp": LINEAR})
+    run(tool, ["--append-history", store, "--commit", "c3", "a.cpp"], cwd=work)
+    with open(store, "r+b") as f:
+        f.truncate(os.path.getsize(store) - 3)
+    result = run(tool, ["--append-history", store, "--commit", "c4", "a.cpp"], cwd=work)
+    check(b"incomplete run" in result.stderr, "test_history", "a cut-short run was not dropped")
+    series = COLORS.sub("", run(tool, ["--history", store, "--function", "total"], cwd=work).stdout.decode()).split()
+    check([word for word in series if word.startswith("c")] == ["c1", "c2", "c4"], "test_history", f"series after recovery is {series}")
+
+
+@scenario
+def test_compile_commands(tool, work):
+    """A compile database supplies the include directories that resolve a unit's headers"""
+    write_files(work, {
+        "inc/cost.h": LINEAR.replace("int total", "inline int work"),
+        "src/main.cpp": '#include "cost.h"\nint run(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) {\n        s += work(n);\n    }\n    return s;\n}\n',
+    })
+    databases = {
+        "command": [{"directory": os.path.join(work, "build"), "command": "c++ -I../inc -c ../src/main.cpp", "file": "../src/main.cpp"}],
+        "arguments": [{"directory": ".", "arguments": ["c++", "-I", "../inc", "-c", "../src/main.cpp"], "file": "../src/main.cpp"}],
+    }
+    for form, entries in databases.items():
+        write_files(work, {"build/compile_commands.json": json.dumps(entries)})
+        result = run(tool, ["--compile-commands", "build", "--format", "json"], cwd=work)
+        costs = {name: cost for (file, name), cost in function_costs(result.stdout).items()}
+        check(costs.get("run") == "O(n²)" and costs.get("work") == "O(n)", "test_compile_commands", f"{form} form gave {costs}")
+    costs = {name: cost for (file, name), cost in function_costs(run(tool, ["--format", "json", "src"], cwd=work).stdout).items()}
+    check(costs.get("run") == "O(n)", "test_compile_commands", f"without the database run is {costs.get('run')}")
+    result = run(tool, ["--compile-commands", "missing.json"], cwd=work)
+    check(result.returncode != 0 and result.stderr, "test_compile_commands", "accepted a missing database")
+
+
+@scenario
+def test_preprocess(tool, work):
+    """--preprocess expands macro-hidden loops and drops branches its -D flags do not take"""
+    check(run(tool, ["-DSLOW", "."], cwd=work).returncode == 1, "test_preprocess", "accepted -D without --preprocess")
+    if not shutil.which("c++"):
+        return
+    write_files(work, {"m.cpp": (
+        "#define REPEAT(i, n) for (int i = 0; i < (n); i++)\n"
+        "int total(int n) {\n    int s = 0;\n    REPEAT(i, n) {\n        s += i;\n    }\n    return s;\n}\n"
+        "int pick(int n) {\n    int s = 0;\n#ifdef SLOW\n    for (int i = 0; i < n; i++) {\n        for (int j = 0; j < n; j++) {\n"
+        "            s++;\n        }\n    }\n#endif\n    return s;\n}\n")})
+    for args, expected in (([], {"total": "O(1)", "pick": "O(n²)"}), (["--preprocess"], {"total": "O(n)", "pick": "O(1)"}),
+                           (["--preprocess", "-DSLOW"], {"total": "O(n)", "pick": "O(n²)"})):
+        costs = {name: cost for (file, name), cost in function_costs(run(tool, args + ["--format", "json", "m.cpp"], cwd=work).stdout).items()}
+        check(costs == expected, "test_preprocess", f"{args} gave {costs}")
+
+
+@scenario
+def test_include_graph(tool, work):
+    """A header shared by content still resolves calls through its own includes"""
+    linear = "inline int work(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) {\n        s += i;\n    }\n    return s;\n}\n"
+    use = '#include "cost.h"\ninline int use(int n) {\n    return work(n);\n}\n'
+    main = '#include "use.h"\nint run(int n) {\n    return use(n);\n}\n'
+    write_files(work, {
+        "a/cost.h": "inline int work(int n) { return n; }\n", "a/use.h": use, "a/main.cpp": main,
+        "b/cost.h": linear, "b/use.h": use, "b/main.cpp": main,
+    })
+    result = run(tool, ["--include-graph", "--format", "json", "a", "b"], cwd=work)
+    costs = function_costs(result.stdout)
+    check(costs.get(("a/use.h", "use")) == "O(1)", "test_include_graph", f"a/use.h is {costs.get(('a/use.h', 'use'))}")
+    check(costs.get(("b/use.h", "use")) == "O(n)", "test_include_graph", f"b/use.h is {costs.get(('b/use.h', 'use'))}")
+    check(costs.get(("b/main.cpp", "run")) == "O(n)", "test_include_graph", f"b/main.cpp is {costs.get(('b/main.cpp', 'run'))}")
+
+
+@scenario
+def test_index(tool, work):
+    """The results index answers class and name queries and survives corruption"""
+    shutil.copy(os.path.join(FIXTURES, "graph_edges.cpp"), work)
+    index = os.path.join(work, "results.idx")
+    check(run(tool, ["--write-index", index, "."], cwd=work).returncode == 0, "test_index", "cannot write the index")
+    result = run(tool, ["--query", index, "--class", "QUADRATIC"], cwd=work)
+    found = result.stdout.decode().splitlines()
+    check(any(line.startswith("O(n²)") and "function pairs" in line for line in found), "test_index", f"quadratic query gave {found}")
+    result = run(tool, ["--query", index, "--name", "edges_of"], cwd=work)
+    check("O(adj + |adj|)" in result.stdout.decode(), "test_index", "name query missed edges_of")
+    check(run(tool, ["--query", index, "--class", "bogus"], cwd=work).returncode == 1, "test_index", "accepted an unknown class")
+    with open(index, "rb") as f:
+        data = bytearray(f.read())
+    for offset in range(64, len(data), 7):
+        data[offset] ^= 0x5A
+    with open(index, "wb") as f:
+        f.write(data)
+    result = run(tool, ["--query", index, "--class", "linear"], cwd=work)
+    check(result.returncode in (0, 2), "test_index", f"corrupt index query exited with {result.returncode}")
+    with open(index, "wb") as f:
+        f.write(data[:100])
+    check(run(tool, ["--query", index], cwd=work).returncode == 2, "test_index", "opened a truncated index")
+
+
+@scenario
+def test_diff(tool, work):
+    """Diff paths resolve whatever prefix git wrote and unresolved ones are reported"""
+    write_files(work, {"src/x.cpp": "int f(int n) {\n    int s = 0;\n    for (int i = 0; i < n; i++) s += i;\n    return s;\n}\n"})
+    hunk = "@@ -1,3 +1,5 @@\n int f(int n) {\n-    return n;\n+    int s = 0;\n+    for (int i = 0; i < n; i++) s += i;\n+    return s;\n }\n"
+    for old, new in (("a/src/x.cpp", "b/src/x.cpp"), ("src/x.cpp", "src/x.cpp"), ("old/src/x.cpp", "new/src/x.cpp")):
+        result = run(tool, ["--diff", "-"], stdin=f"--- {old}\n+++ {new}\n{hunk}".encode(), cwd=work)
+        output = COLORS.sub("", result.stdout.decode())
+        check("O(n) src/x.cpp:1-5 in f" in output, "test_diff", f"+++ {new} gave {output!r}")
+    result = run(tool, ["--diff", "-"], stdin=f"--- a/src/y.cpp\n+++ b/src/y.cpp\n{hunk}".encode(), cwd=work)
+    check("b/src/y.cpp" in result.stderr.decode(), "test_diff", "no warning for a path that does not resolve")
+
+
+class LspClient:
+    def __init__(self, tool):
+        self.process = subprocess.Popen([tool, "--lsp"], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+    def send(self, message):
+        body = json.dumps(dict(message, jsonrpc="2.0")).encode()
+        self.process.stdin.write(b"Content-Length: %d\r\n\r\n" % len(body) + body)
+        self.process.stdin.flush()
+
+    def receive(self):
+        length = 0
+        while True:
+            header = self.process.stdout.readline().strip()
+            if not header:
+                break
+            if header.startswith(b"Content-Length:"):
+                length = int(header.split(b":")[1])
+        return json.loads(self.process.stdout.read(length))
+
+    def diagnostics(self, method, params):
+        self.send({"method": method, "params": params})
+        found = self.receive()["params"]["diagnostics"]
+        return sorted((d["range"]["start"]["line"], d["range"]["start"]["character"], d["message"]) for d in found)
+
+    def close(self):
+        self.send({"id": 2, "method": "shutdown"})
+        self.receive()
+        self.send({"method": "exit"})
+        self.process.wait(timeout=60)
+
+
+@scenario
+def test_lsp(tool, work):
+    """Edits re-analyze the functions they touch and agree with a fresh open"""
+    source = ("}\nint odd(int n);\nint even(int n) {\n    if (n == 0) return 1;\n    return odd(n - 1);\n}\n"
+              "int odd(int n) {\n    if (n == 0) return 0;\n    return even(n - 1);\n}\n"
+              "int total(int n) {\n    int s = 0;\n    s += odd(n);\n    return s;\n}\n")
+    edits = [
+        ({"start": {"line": 13, "character": 0}, "end": {"line": 13, "character": 0}}, "    for (int i = 0; i < n; i++) {\n        s += even(i);\n    }\n"),
+        ({"start": {"line": 8, "character": 0}, "end": {"line": 9, "character": 0}}, ""),
+        ({"start": {"line": 0, "character": 0}, "end": {"line": 1, "character": 0}}, ""),
+    ]
+    client = LspClient(tool)
+    try:
+        client.send({"id": 1, "method": "initialize", "params": {}})
+        client.receive()
+        client.diagnostics("textDocument/didOpen", {"textDocument": {"uri": "file:///a.cpp", "text": source, "version": 1}})
+        lines = source.split("\n")
+        for version, (span, text) in enumerate(edits, 2):
+            incremental = client.diagnostics("textDocument/didChange", {"textDocument": {"uri": "file:///a.cpp", "version": version},
+                                                                        "contentChanges": [{"range": span, "text": text}]})
+            first, last = span["start"]["line"], span["end"]["line"]
+            lines[first:last] = text.split("\n")[:-1]
+            fresh = client.diagnostics("textDocument/didOpen", {"textDocument": {"uri": f"file:///b{version}.cpp", "text": "\n".join(lines), "version": 1}})
+            check(incremental == fresh, "test_lsp", f"edit {version - 1} gave {incremental}, a fresh open gave {fresh}")
+        check(any("total: O(n)" in d[2] for d in incremental), "test_lsp", f"the loop did not reach total: {incremental}")
+    finally:
+        client.close()
+
+
+@scenario
+def test_incremental_rescan(tool, work):
+    """An edit that opens a comment or a brace rescans past its own lines until the scanner agrees again"""
+    source = LINEAR + QUADRATIC + EXPONENTIAL
+    edits = [
+        ({"start": {"line": 8, "character": 0}, "end": {"line": 8, "character": 0}}, "/*\n"),
+        ({"start": {"line": 8, "character": 0}, "end": {"line": 9, "character": 0}}, ""),
+        ({"start": {"line": 3, "character": 0}, "end": {"line": 3, "character": 0}}, "    {\n"),
+        ({"start": {"line": 3, "character": 0}, "end": {"line": 4, "character": 0}}, ""),
+    ]
+    client = LspClient(tool)
+    try:
+        client.send({"id": 1, "method": "initialize", "params": {}})
+        client.receive()
+        opened = client.diagnostics("textDocument/didOpen", {"textDocument": {"uri": "file:///a.cpp", "text": source, "version": 1}})
+        lines = source.split("\n")
+        for version, (span, text) in enumerate(edits, 2):
+            incremental = client.diagnostics("textDocument/didChange", {"textDocument": {"uri": "file:///a.cpp", "version": version},
+                                                                        "contentChanges": [{"range": span, "text": text}]})
+            lines[span["start"]["line"]:span["end"]["line"]] = text.split("\n")[:-1]
+            fresh = client.diagnostics("textDocument/didOpen", {"textDocument": {"uri": f"file:///b{version}.cpp", "text": "\n".join(lines), "version": 1}})
+            check(incremental == fresh, "test_incremental_rescan", f"edit {version - 1} gave {incremental}, a fresh open gave {fresh}")
+            if version == 2:
+                check(not any("subsets" in d[2] for d in incremental), "test_incremental_rescan", "a commented-out function is still analyzed")
+        check(incremental == opened, "test_incremental_rescan", "undoing every edit did not restore the diagnostics")
+    finally:
+        client.close()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip().splitlines()[2])
+        return 2
+    tool = os.path.abspath(sys.argv[1])
+    pattern = sys.argv[2] if len(sys.argv) > 2 else ""
+    count = 0
+    for entry in sorted(os.listdir(FIXTURES)):
+        if entry.endswith(".cpp") and pattern in entry:
+            check_fixture(tool, os.path.join(FIXTURES, entry))
+            count += 1
+    for test in SCENARIOS:
+        if pattern in test.__name__:
+            work = tempfile.mkdtemp(prefix="time-test-")
+            try:
+                test(tool, work)
+            except Exception as e:
+                failures.append(f"{test.__name__}: {type(e).__name__}: {e}")
+            finally:
+                shutil.rmtree(work, ignore_errors=True)
+            count += 1
+    for failure in failures:
+        print("FAIL " + failure)
+    print(f"{count} tests, {len(failures)} failures")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,13 +2,66 @@
 #include <string>
 #include <vector>
 #include <regex>
-#include <stack>
 #include <unordered_map>
+#include <map>
 #include <iomanip>
 #include <locale>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string_view>
+#include <cstdint>
+#include <unordered_set>
+#include <tuple>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <set>
+#include <cstdio>
+#include <mutex>
+#include <memory>
+#include <csignal>
+#include <cstring>
+#include <charconv>
+#include <condition_variable>
+#include <chrono>
+#include <shared_mutex>
+#include <limits>
+#include <list>
 
 using namespace std;
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <io.h>
+#include <fcntl.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define popen _popen
+#define pclose _pclose
+#define NULL_DEVICE "NUL"
+typedef SOCKET socket_handle;
+#define close_socket closesocket
+#define SHUT_WR SD_SEND
+#define read_stdin(buffer, size) _read(0, buffer, static_cast<unsigned>(size))
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+typedef int socket_handle;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define read_stdin(buffer, size) read(0, buffer, size)
+#endif
+
 // ANSI color codes
 #define RESET   "\033[0m"
 #define RED     "\033[31m"
@@ -28,217 +81,6284 @@ enum class Complexity {
     QUADRATIC,     // O(n²)
     CUBIC,         // O(n³)
     LINEARITHMIC,  // O(n log n)
+    LOGARITHMIC,   // O(log n)
+    EXPONENTIAL,   // O(2^n), O(n!)
     UNKNOWN
 };
 
-// Structure to hold analysis results
-struct CodeAnalysis {
-    int line_number;
-    string code;
-    Complexity complexity;
-    string reason;
+// Format a number without trailing zeros, e.g. 2, 1.5, 1.58
+static string format_number(double value) {
+    ostringstream out;
+    out << fixed << setprecision(2) << value;
+    string s = out.str();
+    s.erase(s.find_last_not_of('0') + 1);
+    if (s.back() == '.') s.pop_back();
+    return s;
+}
+
+// One factor of a cost term: size^power · log^log_power(size). Powers
+// may be fractional, e.g. n^1.58 from a Master-theorem solution. A base
+// makes the factor exponential (base^size), and factorial means size!.
+struct CostFactor {
+    string size;
+    double power = 0;
+    int log_power = 0;
+    string base;
+    bool factorial = false;
+
+    // Numeric value of the exponential base; symbolic bases such as k
+    // are assumed to outgrow any constant
+    double base_value() const {
+        if (base.empty()) return 0;
+        char* end = nullptr;
+        double value = strtod(base.c_str(), &end);
+        return *end == '\0' ? value : 1e6;
+    }
+
+    bool is_exponential() const { return factorial || !base.empty(); }
 };
 
-class ComplexityAnalyzer {
-private:
-    vector<string> code_lines;
-    unordered_map<string, int> function_calls;
-    stack<string> block_stack;
-    string current_function;
-    int nesting_level = 0;
-    int max_nesting = 0;
+// Product of factors such as rows·cols or n log n (no factors means 1)
+struct CostTerm {
+    vector<CostFactor> factors;
 
-    // Helper function to trim whitespace
-    static string trim(const string& str) {
-        const regex pattern("^\\s+|\\s+$");
-        return regex_replace(str, pattern, "");
+    const CostFactor* find(const string& size) const {
+        for (const auto& f : factors) {
+            if (f.size == size) return &f;
+        }
+        return nullptr;
     }
 
-    // Check if line is a comment
-    static bool is_comment(const string& line) {
-        return line.empty() || line.substr(0, 2) == "//";
+    double degree() const {
+        double d = 0;
+        for (const auto& f : factors) d += f.power;
+        return d;
     }
 
-    // Detect recursive function calls
-    bool is_recursive(const string& line, const string& func_name) const {
-        if (func_name.empty()) return false;
-        return regex_search(line, regex("\\b" + func_name + "\\s*\\("));
+    int log_degree() const {
+        int d = 0;
+        for (const auto& f : factors) d += f.log_power;
+        return d;
     }
 
-    // Track function definitions in the code
-    void track_function_definitions() {
-        for (const auto& line : code_lines) {
-            smatch match;
-            if (regex_search(line, match, regex(R"(\b([a-zA-Z_][a-zA-Z0-9_]*)\s*\([^)]*\)\s*(?:const)?\s*[{;])"))) {
-                function_calls[match[1].str()]++;
+    bool is_exponential() const {
+        return any_of(factors.begin(), factors.end(), [](const CostFactor& f) { return f.is_exponential(); });
+    }
+
+    // 0 for polynomial terms, 1 for base^size, 2 when a size! factor
+    // outgrows every exponential
+    int exponential_rank() const {
+        int rank = 0;
+        for (const auto& f : factors) rank = max(rank, f.factorial ? 2 : f.base.empty() ? 0 : 1);
+        return rank;
+    }
+
+    // True when this term grows at least as fast as other in every size,
+    // comparing factorial, then exponential base, then power, then logs
+    bool dominates(const CostTerm& other) const {
+        for (const auto& f : other.factors) {
+            const CostFactor* mine = find(f.size);
+            CostFactor none;
+            const CostFactor& m = mine ? *mine : none;
+            if (m.factorial != f.factorial) {
+                if (f.factorial) return false;
+                continue;
             }
+            if (fabs(m.base_value() - f.base_value()) > 1e-9) {
+                if (m.base_value() < f.base_value()) return false;
+                continue;
+            }
+            if (m.power < f.power - 1e-9 || (fabs(m.power - f.power) < 1e-9 && m.log_power < f.log_power)) return false;
         }
+        return true;
     }
 
-public:
-    explicit ComplexityAnalyzer(const vector<string>& code) : code_lines(code) {}
+    CostTerm operator*(const CostTerm& other) const {
+        CostTerm result = *this;
+        for (const auto& f : other.factors) {
+            auto it = find_if(result.factors.begin(), result.factors.end(),
+                [&](const CostFactor& r) { return r.size == f.size; });
+            if (it == result.factors.end()) {
+                result.factors.push_back(f);
+            }
+            else {
+                it->power += f.power;
+                it->log_power += f.log_power;
+                it->factorial = it->factorial || f.factorial;
+                if (f.base_value() > it->base_value()) it->base = f.base;
+            }
+        }
+        return result;
+    }
 
-    // Convert complexity enum to string with color
-    static string complexity_to_string(Complexity c) {
-        switch (c) {
-        case Complexity::CONSTANT:     return GREEN + string("O(1)") + RESET;
-        case Complexity::LINEAR:       return YELLOW + string("O(n)") + RESET;
-        case Complexity::QUADRATIC:    return RED + string("O(n²)") + RESET;
-        case Complexity::CUBIC:        return MAGENTA + string("O(n³)") + RESET;
-        case Complexity::LINEARITHMIC: return CYAN + string("O(n log n)") + RESET;
-        default:                      return WHITE + string("Unknown") + RESET;
+    string to_string() const {
+        static const char* superscripts[] = { "", "", "²", "³" };
+        string powers, exponentials, logs;
+        for (const auto& f : factors) {
+            if (f.factorial || !f.base.empty()) {
+                if (!exponentials.empty()) exponentials += "·";
+                exponentials += f.factorial ? f.size + "!" : f.base + "^" + f.size;
+            }
+            if (f.power > 0) {
+                if (!powers.empty()) powers += "·";
+                bool whole = fabs(f.power - round(f.power)) < 1e-9;
+                powers += f.size + (whole && f.power < 4 ? string(superscripts[static_cast<int>(round(f.power))]) : "^" + format_number(f.power));
+            }
+            if (f.log_power > 0) {
+                if (!logs.empty()) logs += " ";
+                logs += "log" + (f.log_power < 4 ? string(superscripts[f.log_power]) : "^" + std::to_string(f.log_power)) + " " + f.size;
+            }
         }
+        if (!exponentials.empty()) powers += (powers.empty() ? "" : "·") + exponentials;
+        if (powers.empty()) return logs.empty() ? "1" : logs;
+        return logs.empty() ? powers : powers + " " + logs;
     }
+};
 
-    // Get explanation for the complexity with color
-    string get_complexity_reason(const string& line, Complexity complexity) const {
-        switch (complexity) {
-        case Complexity::CONSTANT:
-            return GREEN + string("Constant time operation (no loops)") + RESET;
+// Symbolic cost over named input sizes: a sum of product terms such as
+// V + E or rows·cols. Dominated terms are dropped, and an empty sum is O(1).
+class Cost {
+private:
+    vector<CostTerm> terms;
 
-        case Complexity::LINEAR:
-            if (regex_search(line, regex(R"(\b(for|while)\s*\()"))) {
-                return YELLOW + string("Single loop running n times") + RESET;
-            }
-            return YELLOW + string("Linear time operation") + RESET;
+    void add_term(const CostTerm& term) {
+        if (term.factors.empty()) return;
+        for (const auto& t : terms) {
+            if (t.dominates(term)) return;
+        }
+        terms.erase(remove_if(terms.begin(), terms.end(),
+            [&](const CostTerm& t) { return term.dominates(t); }), terms.end());
+        terms.push_back(term);
+    }
 
-        case Complexity::QUADRATIC:
-            return RED + string("Nested loops (n × n iterations)") + RESET;
+public:
+    Cost() = default;
 
-        case Complexity::CUBIC:
-            return MAGENTA + string("Triple nested loops (n × n × n iterations)") + RESET;
+    static Cost of_size(const string& size, double power = 1, int log_power = 0) {
+        Cost c;
+        if (power > 0 || log_power > 0) c.terms.push_back({ { { size, power, log_power, "", false } } });
+        return c;
+    }
 
-        case Complexity::LINEARITHMIC:
-            return CYAN + string("Divide-and-conquer or recursive algorithm") + RESET;
+    // base^size, e.g. 2^n for naive Fibonacci
+    static Cost of_exponential(const string& size, const string& base) {
+        Cost c;
+        c.terms.push_back({ { { size, 0, 0, base, false } } });
+        return c;
+    }
 
-        default:
-            return WHITE + string("Unable to determine complexity") + RESET;
+    // size!, e.g. permutations generated by n·T(n-1)
+    static Cost of_factorial(const string& size) {
+        Cost c;
+        c.terms.push_back({ { { size, 0, 0, "", true } } });
+        return c;
+    }
+
+    // log of a cost: log(n²) and log(n·m) both count as a single log factor
+    static Cost log_of(const Cost& cost) {
+        Cost result;
+        for (const auto& t : cost.terms) {
+            auto largest = max_element(t.factors.begin(), t.factors.end(),
+                [](const CostFactor& a, const CostFactor& b) { return a.power < b.power; });
+            if (largest != t.factors.end()) result.add_term({ { { largest->size, 0, 1, "", false } } });
         }
+        return result;
     }
 
-    // Analyze a single line of code
-    Complexity analyze_line(const string& line) {
-        if (is_comment(line)) return Complexity::CONSTANT;
+    bool is_constant() const { return terms.empty(); }
+    const vector<CostTerm>& get_terms() const { return terms; }
 
-        // Check for loops
-        if (regex_search(line, regex(R"(\b(for|while)\s*\()"))) {
-            if (nesting_level == 0) return Complexity::LINEAR;
-            if (nesting_level == 1) return Complexity::QUADRATIC;
-            return Complexity::CUBIC;
+    // Rename sizes, e.g. a callee's parameter m to the caller's argument
+    // rows. Renaming to an empty name drops the factor (a constant argument).
+    Cost rename(const unordered_map<string, string>& names) const {
+        Cost result;
+        for (const auto& t : terms) {
+            CostTerm renamed;
+            for (CostFactor f : t.factors) {
+                auto it = names.find(f.size);
+                if (it != names.end()) {
+                    if (it->second.empty()) continue;
+                    f.size = it->second;
+                }
+                renamed = renamed * CostTerm{ { f } };
+            }
+            result.add_term(renamed);
         }
+        return result;
+    }
 
-        // Check for recursion
-        if (!current_function.empty() && is_recursive(line, current_function)) {
-            return Complexity::LINEARITHMIC;
+    Cost operator+(const Cost& other) const {
+        Cost result = *this;
+        for (const auto& t : other.terms) result.add_term(t);
+        return result;
+    }
+
+    Cost operator*(const Cost& other) const {
+        if (is_constant()) return other;
+        if (other.is_constant()) return *this;
+        Cost result;
+        for (const auto& a : terms) {
+            for (const auto& b : other.terms) result.add_term(a * b);
         }
+        return result;
+    }
 
-        // Check for function calls
-        if (regex_search(line, regex(R"(\b[a-zA-Z_][a-zA-Z0-9_]*\s*\([^)]*\)\s*;)"))) {
-            return Complexity::UNKNOWN;
+    // Degree and log degree of the fastest-growing term
+    pair<double, int> dominant_degree() const {
+        double degree = 0;
+        int log_degree = 0;
+        for (const auto& t : terms) {
+            if (t.degree() > degree + 1e-9 || (fabs(t.degree() - degree) < 1e-9 && t.log_degree() > log_degree)) {
+                degree = t.degree();
+                log_degree = t.log_degree();
+            }
         }
+        return { degree, log_degree };
+    }
 
-        return Complexity::CONSTANT;
+    bool is_exponential() const {
+        return any_of(terms.begin(), terms.end(), [](const CostTerm& t) { return t.is_exponential(); });
     }
 
-    // Analyze the entire code
-    vector<CodeAnalysis> analyze() {
-        vector<CodeAnalysis> results;
-        track_function_definitions();
+    int exponential_rank() const {
+        int rank = 0;
+        for (const auto& t : terms) rank = max(rank, t.exponential_rank());
+        return rank;
+    }
 
-        for (size_t i = 0; i < code_lines.size(); ++i) {
-            string line = trim(code_lines[i]);
+    // Ranking key: factorial, then exponential costs first, then degree,
+    // then log degree
+    tuple<int, double, int> growth() const {
+        auto [degree, log_degree] = dominant_degree();
+        return { exponential_rank(), degree, log_degree };
+    }
 
-            // Track function declarations
-            smatch match;
-            if (regex_search(line, match, regex(R"(\b([a-zA-Z_][a-zA-Z0-9_]*)\s*\([^)]*\)\s*(?:const)?\s*[{])"))) {
-                current_function = match[1].str();
-            }
+    // Coarse class of the fastest-growing term, used for colors and ranking
+    Complexity classify() const {
+        if (is_exponential()) return Complexity::EXPONENTIAL;
+        auto [degree, log_degree] = dominant_degree();
+        if (degree < 1e-9) return log_degree > 0 ? Complexity::LOGARITHMIC : Complexity::CONSTANT;
+        if (degree < 1 + 1e-9) return log_degree > 0 ? Complexity::LINEARITHMIC : Complexity::LINEAR;
+        if (degree < 2 + 1e-9) return Complexity::QUADRATIC;
+        return Complexity::CUBIC;
+    }
+
+    // The expression inside O(...), e.g. "V + E"
+    string expression() const {
+        if (terms.empty()) return "1";
+        vector<CostTerm> sorted = terms;
+        stable_sort(sorted.begin(), sorted.end(), [](const CostTerm& a, const CostTerm& b) {
+            if (a.is_exponential() != b.is_exponential()) return a.is_exponential();
+            return a.degree() > b.degree() || (a.degree() == b.degree() && a.log_degree() > b.log_degree());
+            });
+        string out;
+        for (const auto& t : sorted) {
+            if (!out.empty()) out += " + ";
+            out += t.to_string();
+        }
+        return out;
+    }
+
+    string to_string() const { return "O(" + expression() + ")"; }
+};
+
+// Cost of a standard library call in the size of the container it works on
+enum class StdCost : unsigned char {
+    CONSTANT,
+    LOG,
+    LINEAR,
+    N_LOG_N,
+    N_LOG2_N
+};
+
+// Amortized (or average) and worst-case cost of a std algorithm or
+// container member, keyed as "std::sort" or "vector::push_back"
+struct StdCallCost {
+    string_view name;
+    StdCost amortized;
+    StdCost worst;
+};
+
+static constexpr StdCallCost std_call_costs[] = {
+    { "std::sort", StdCost::N_LOG_N, StdCost::N_LOG_N },
+    { "std::stable_sort", StdCost::N_LOG_N, StdCost::N_LOG2_N },
+    { "std::partial_sort", StdCost::N_LOG_N, StdCost::N_LOG_N },
+    { "std::nth_element", StdCost::LINEAR, StdCost::N_LOG_N },
+    { "std::sort_heap", StdCost::N_LOG_N, StdCost::N_LOG_N },
+    { "std::make_heap", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::push_heap", StdCost::LOG, StdCost::LOG },
+    { "std::pop_heap", StdCost::LOG, StdCost::LOG },
+    { "std::is_sorted", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::find", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::find_if", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::find_if_not", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::count", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::count_if", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::accumulate", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::reduce", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::for_each", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::transform", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::copy", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::copy_if", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::fill", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::iota", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::reverse", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::rotate", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::unique", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::remove", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::remove_if", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::replace", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::min_element", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::max_element", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::minmax_element", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::equal", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::all_of", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::any_of", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::none_of", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::shuffle", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::next_permutation", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::merge", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::set_union", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::set_intersection", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::includes", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::partition", StdCost::LINEAR, StdCost::LINEAR },
+    { "std::lower_bound", StdCost::LOG, StdCost::LOG },
+    { "std::upper_bound", StdCost::LOG, StdCost::LOG },
+    { "std::binary_search", StdCost::LOG, StdCost::LOG },
+    { "std::equal_range", StdCost::LOG, StdCost::LOG },
+    { "vector::push_back", StdCost::CONSTANT, StdCost::LINEAR },
+    { "vector::emplace_back", StdCost::CONSTANT, StdCost::LINEAR },
+    { "vector::pop_back", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "vector::insert", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::emplace", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::erase", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::clear", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::resize", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::reserve", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::assign", StdCost::LINEAR, StdCost::LINEAR },
+    { "vector::size", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "vector::empty", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "vector::at", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "vector::front", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "vector::back", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "deque::push_back", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "deque::push_front", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "deque::pop_back", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "deque::pop_front", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "deque::insert", StdCost::LINEAR, StdCost::LINEAR },
+    { "deque::erase", StdCost::LINEAR, StdCost::LINEAR },
+    { "list::push_back", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "list::push_front", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "list::insert", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "list::erase", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "list::sort", StdCost::N_LOG_N, StdCost::N_LOG_N },
+    { "list::remove", StdCost::LINEAR, StdCost::LINEAR },
+    { "list::size", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "map::find", StdCost::LOG, StdCost::LOG },
+    { "map::insert", StdCost::LOG, StdCost::LOG },
+    { "map::emplace", StdCost::LOG, StdCost::LOG },
+    { "map::erase", StdCost::LOG, StdCost::LOG },
+    { "map::count", StdCost::LOG, StdCost::LOG },
+    { "map::at", StdCost::LOG, StdCost::LOG },
+    { "map::contains", StdCost::LOG, StdCost::LOG },
+    { "map::lower_bound", StdCost::LOG, StdCost::LOG },
+    { "map::upper_bound", StdCost::LOG, StdCost::LOG },
+    { "multimap::find", StdCost::LOG, StdCost::LOG },
+    { "multimap::insert", StdCost::LOG, StdCost::LOG },
+    { "multimap::count", StdCost::LOG, StdCost::LINEAR },
+    { "set::find", StdCost::LOG, StdCost::LOG },
+    { "set::insert", StdCost::LOG, StdCost::LOG },
+    { "set::emplace", StdCost::LOG, StdCost::LOG },
+    { "set::erase", StdCost::LOG, StdCost::LOG },
+    { "set::count", StdCost::LOG, StdCost::LOG },
+    { "set::contains", StdCost::LOG, StdCost::LOG },
+    { "set::lower_bound", StdCost::LOG, StdCost::LOG },
+    { "set::upper_bound", StdCost::LOG, StdCost::LOG },
+    { "multiset::insert", StdCost::LOG, StdCost::LOG },
+    { "multiset::count", StdCost::LOG, StdCost::LINEAR },
+    { "unordered_map::find", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::insert", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::emplace", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::erase", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::count", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::at", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::contains", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_map::reserve", StdCost::LINEAR, StdCost::LINEAR },
+    { "unordered_map::rehash", StdCost::LINEAR, StdCost::LINEAR },
+    { "unordered_set::find", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_set::insert", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_set::emplace", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_set::erase", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_set::count", StdCost::CONSTANT, StdCost::LINEAR },
+    { "unordered_set::contains", StdCost::CONSTANT, StdCost::LINEAR },
+    { "string::find", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::rfind", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::substr", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::append", StdCost::CONSTANT, StdCost::LINEAR },
+    { "string::push_back", StdCost::CONSTANT, StdCost::LINEAR },
+    { "string::insert", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::erase", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::replace", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::compare", StdCost::LINEAR, StdCost::LINEAR },
+    { "string::size", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "string::length", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "string::c_str", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "priority_queue::push", StdCost::LOG, StdCost::LOG },
+    { "priority_queue::emplace", StdCost::LOG, StdCost::LOG },
+    { "priority_queue::pop", StdCost::LOG, StdCost::LOG },
+    { "priority_queue::top", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "queue::push", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "queue::pop", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "stack::push", StdCost::CONSTANT, StdCost::CONSTANT },
+    { "stack::pop", StdCost::CONSTANT, StdCost::CONSTANT },
+};
+
+// Compile-time perfect hash over std_call_costs. A seed is searched for
+// during compilation so that every name lands in its own slot; a lookup is
+// then one FNV-1a hash, one slot read and one string compare.
+static constexpr size_t std_cost_slots = 2048;
+
+static constexpr uint32_t std_cost_hash(string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h & (std_cost_slots - 1);
+}
+
+static constexpr uint32_t find_std_cost_seed() {
+    for (uint32_t seed = 0; seed < 10000; ++seed) {
+        bool used[std_cost_slots] = {};
+        bool distinct = true;
+        for (const auto& entry : std_call_costs) {
+            uint32_t slot = std_cost_hash(entry.name, seed);
+            distinct = distinct && !used[slot];
+            used[slot] = true;
+        }
+        if (distinct) return seed;
+    }
+    return UINT32_MAX;
+}
+
+static constexpr uint32_t std_cost_seed = find_std_cost_seed();
+static_assert(std_cost_seed != UINT32_MAX, "no perfect hash seed for std_call_costs");
+static_assert(size(std_call_costs) < 256, "slot indexes are stored in a byte");
+
+struct StdCostSlots {
+    unsigned char index[std_cost_slots];  // entry + 1, 0 for an empty slot
+};
+
+static constexpr StdCostSlots build_std_cost_slots() {
+    StdCostSlots slots{};
+    for (size_t i = 0; i < size(std_call_costs); ++i) {
+        slots.index[std_cost_hash(std_call_costs[i].name, std_cost_seed)] = static_cast<unsigned char>(i + 1);
+    }
+    return slots;
+}
 
-            // Track block openings
-            if (regex_search(line, regex(R"(\b(for|while)\s*\()"))) {
-                block_stack.push("loop");
-                nesting_level++;
-                max_nesting = max(max_nesting, nesting_level);
+static constexpr StdCostSlots std_cost_table = build_std_cost_slots();
+
+static const StdCallCost* find_std_call_cost(string_view name) {
+    unsigned char index = std_cost_table.index[std_cost_hash(name, std_cost_seed)];
+    if (index == 0 || std_call_costs[index - 1].name != name) return nullptr;
+    return &std_call_costs[index - 1];
+}
+
+// Cost of a std call over a container of the given size
+static Cost std_cost_of(StdCost kind, const string& size) {
+    switch (kind) {
+    case StdCost::LOG:      return Cost::of_size(size, 0, 1);
+    case StdCost::LINEAR:   return Cost::of_size(size);
+    case StdCost::N_LOG_N:  return Cost::of_size(size, 1, 1);
+    case StdCost::N_LOG2_N: return Cost::of_size(size, 1, 2);
+    default:                return Cost();
+    }
+}
+
+// Options that change how costs are assigned
+struct FunctionInfo;
+
+struct AnalyzerOptions {
+    bool worst_case = false;  // use worst-case rather than amortized std costs
+    // Functions defined in headers the source includes, by name; calls to
+    // them cost what the header's own analysis found
+    const unordered_map<string, const FunctionInfo*>* headers = nullptr;
+};
+
+// Parallelism work / span, dividing the dominant terms of each, e.g.
+// n / log n for a parallel loop with a constant body
+static string parallelism_of(const Cost& work, const Cost& span) {
+    auto dominant = [](const Cost& cost) {
+        CostTerm best;
+        for (const auto& term : cost.get_terms()) {
+            if (make_pair(term.degree(), term.log_degree()) > make_pair(best.degree(), best.log_degree())) best = term;
+        }
+        return best;
+    };
+    CostTerm numerator = dominant(work), denominator, critical = dominant(span);
+    long tied = count_if(span.get_terms().begin(), span.get_terms().end(), [&](const CostTerm& t) {
+        return t.degree() == critical.degree() && t.log_degree() == critical.log_degree();
+    });
+    if (tied > 1) return "O(" + numerator.to_string() + " / (" + span.expression() + "))";
+    for (const auto& f : critical.factors) {
+        auto it = find_if(numerator.factors.begin(), numerator.factors.end(),
+            [&](const CostFactor& n) { return n.size == f.size; });
+        CostFactor left = it == numerator.factors.end() ? CostFactor{ f.size, 0, 0, "", false } : *it;
+        left.power -= f.power;
+        left.log_power -= f.log_power;
+        CostFactor below{ f.size, max(0.0, -left.power), max(0, -left.log_power), "", false };
+        left.power = max(0.0, left.power);
+        left.log_power = max(0, left.log_power);
+        if (it == numerator.factors.end()) numerator.factors.push_back(left);
+        else *it = left;
+        if (below.power > 0 || below.log_power > 0) denominator.factors.push_back(below);
+    }
+    numerator.factors.erase(remove_if(numerator.factors.begin(), numerator.factors.end(),
+        [](const CostFactor& f) { return f.power <= 0 && f.log_power <= 0 && !f.is_exponential(); }), numerator.factors.end());
+    string out = numerator.to_string();
+    if (!denominator.factors.empty()) out += " / " + denominator.to_string();
+    return "O(" + out + ")";
+}
+
+// Structure to hold analysis results
+struct CodeAnalysis {
+    int line_number;
+    string code;
+    Complexity complexity;
+    string reason;
+    Cost cost;
+    Cost space;  // auxiliary memory the line allocates
+};
+
+// A performance problem found on one line, with the exact source span it
+// covers (1-based columns in the original line) and a cheaper alternative
+struct Finding {
+    int line_number;
+    int first_column;
+    int last_column;
+    string rule;
+    string message;
+    string suggestion;
+    Cost cost;
+    int loop_depth;
+};
+
+// An open block. Loop frames also record their induction variable, the
+// bound of the loop itself and the total iterations of their body.
+struct BlockFrame {
+    bool is_loop = false;
+    bool braceless = false;  // single-statement loop body without '{'
+    string var;
+    Cost bound;
+    Cost total;
+    int chain = -1;          // if/else chain this block is a branch of
+    int branch = -1;
+    string parallel;         // how the iterations run in parallel, empty for serial loops
+    int header = -1;         // result index of the loop header line
+    string scope;            // namespace, class or struct name the block opens
+    string drains;           // container a while (!q.empty()) loop empties
+    string range;            // container a range-based for walks, var is its element
+};
+
+// A parallel loop whose body is still open: its work and span so far,
+// relative to one execution of the loop
+struct ParallelRegion {
+    size_t frame;            // index of the loop's frame in the block stack
+    size_t result_index;     // result of the loop header line
+    string kind;
+    Cost work;
+    Cost span;
+};
+
+// How the argument of a self-call shrinks relative to the caller's
+enum class Shrink {
+    NONE,      // could not tell
+    SUBTRACT,  // T(n - c)
+    DIVIDE     // T(n / b)
+};
+
+// A call from one function to another function defined in the code. The
+// shrink of its arguments matters when caller and callee are recursive.
+struct CallSite {
+    string callee;
+    int target = -1;          // index of the callee's definition, -1 if unresolved
+    size_t result_index = 0;  // line result to annotate once solved
+    Shrink shrink = Shrink::NONE;
+    double amount = 0;        // c for SUBTRACT, b for DIVIDE
+    int chain = -1;           // if/else chain of the call, -1 if unconditional
+    int branch = -1;
+    int statement = 0;        // return statement the call is part of, 0 if none
+    Cost loop_bound;          // iterations of loops around the call in the function
+    string size = "n";        // caller parameter the shrinking argument is derived from
+    bool slices = false;      // argument is a copied slice such as s.substr(1)
+    vector<string> args;
+    const FunctionInfo* external = nullptr;  // callee defined in an included header
+};
+
+// Closed-form solution of a recurrence
+struct RecurrenceSolution {
+    bool solved = false;
+    Cost cost;
+    string method;
+};
+
+// Recurrence T(n) = a·T(n/b) + f(n) or a·T(n-c) + f(n) for a recursive
+// function. Calls with different divisors are kept apart for Akra–Bazzi.
+struct Recurrence {
+    string size = "n";
+    int calls = 0;                    // a: self-calls per invocation
+    Shrink shrink = Shrink::NONE;
+    vector<pair<int, double>> parts;  // (calls, b or c) per distinct amount
+    Cost branching;                   // iterations of a loop around the calls
+    Cost work;                        // f(n): the non-recursive work
+    string unsolved;                  // why it cannot be solved, if so
+
+    string to_string() const {
+        string out = "T(" + size + ") =";
+        string loop = branching.is_constant() ? "" : branching.expression() + "·";
+        if (parts.empty()) out += " " + loop + (calls > 1 ? std::to_string(calls) : "") + "T(?)";
+        for (size_t i = 0; i < parts.size(); ++i) {
+            string arg = shrink == Shrink::SUBTRACT ? size + "-" + format_number(parts[i].second)
+                : size + "/" + format_number(parts[i].second);
+            out += (i ? " + " : " ") + loop + (parts[i].first > 1 ? std::to_string(parts[i].first) : "") + "T(" + arg + ")";
+        }
+        return out + " + " + work.to_string();
+    }
+
+    // Solve with the Master theorem when every call divides by the same b,
+    // Akra–Bazzi when the divisors differ, and by unrolling for T(n-c)
+    RecurrenceSolution solve() const {
+        if (!unsolved.empty()) return { false, Cost(), "unsolved: " + unsolved };
+
+        auto [d, k] = work.dominant_degree();
+        if (shrink == Shrink::SUBTRACT) {
+            // Branching recursion: b calls per level over n/c levels is b^(n/c)
+            double c = parts[0].second;
+            string depth = c > 1 ? size + "/" + format_number(c) : size;
+            if (!branching.is_constant()) {
+                const auto& terms = branching.get_terms();
+                const CostTerm& term = terms.front();
+                if (terms.size() == 1 && term.factors.size() == 1 && term.factors[0].size == size && c <= 1) {
+                    return { true, Cost::of_factorial(size), "branching factor " + size + " shrinking by one, depth " + size };
+                }
+                string base = branching.expression();
+                if (base.find_first_of(" ·") != string::npos) base = "(" + base + ")";
+                return { true, Cost::of_exponential(size, base), "branching factor " + branching.expression() + ", depth " + depth };
             }
-            else if (line.find('{') != string::npos) {
-                block_stack.push("block");
+            if (calls > 1) {
+                string base = format_number(pow(static_cast<double>(calls), 1.0 / c));
+                return { true, Cost::of_exponential(size, base), "branching factor " + std::to_string(calls) + ", depth " + depth };
             }
+            return { true, Cost::of_size(size, d + 1, k), "linear recursion, " + size + " levels of " + work.to_string() + " work" };
+        }
+        if (!branching.is_constant()) {
+            return { false, Cost(), "unsolved: self-call inside a loop over " + branching.expression() };
+        }
 
-            // Analyze the line
-            Complexity comp = analyze_line(line);
-            results.push_back({
-                static_cast<int>(i + 1),
-                line,
-                comp,
-                get_complexity_reason(line, comp)
-                });
-
-            // Track block closings
-            if (line.find('}') != string::npos && !block_stack.empty()) {
-                if (block_stack.top() == "loop") nesting_level--;
-                block_stack.pop();
+        // Find p with Σ a_i·b_i^-p = 1; for a single divisor this is log_b(a)
+        double p = 0;
+        if (parts.size() == 1) {
+            p = log(static_cast<double>(calls)) / log(parts[0].second);
+        }
+        else {
+            double lo = -10, hi = 10;
+            for (int iter = 0; iter < 100; ++iter) {
+                double mid = (lo + hi) / 2, sum = 0;
+                for (const auto& part : parts) sum += part.first * pow(part.second, -mid);
+                (sum > 1 ? lo : hi) = mid;
             }
+            p = (lo + hi) / 2;
         }
+        if (fabs(p - round(p)) < 1e-6) p = round(p);
 
-        return results;
+        string method = parts.size() == 1 ? "Master theorem case " : "Akra–Bazzi (p = " + format_number(p) + "), case ";
+        if (d < p - 1e-9) return { true, Cost::of_size(size, p, 0), method + "1" };
+        if (fabs(d - p) < 1e-9) return { true, Cost::of_size(size, p, k + 1), method + "2" };
+        return { true, Cost::of_size(size, d, k), method + "3" };
     }
+};
 
-    // Estimate overall complexity based on max nesting
-    Complexity estimate_overall_complexity() const {
-        switch (max_nesting) {
-        case 0: return Complexity::CONSTANT;
-        case 1: return Complexity::LINEAR;
-        case 2: return Complexity::QUADRATIC;
-        case 3: return Complexity::CUBIC;
-        default: return Complexity::LINEARITHMIC;
+// A function definition found while scanning, with what it costs
+struct FunctionInfo {
+    string name;
+    string qualified_name;         // with enclosing namespaces and classes, e.g. geo::Grid::fill
+    vector<string> params;
+    int first_line = 0;
+    int last_line = 0;
+    size_t depth = 0;              // block depth outside the body
+    Cost work;                     // loops and other non-recursive work
+    vector<string> halving_vars;   // locals such as mid = (lo + hi) / 2
+    vector<pair<string, string>> upper_bounds;  // parameter and the size it is checked against, i >= n -> (i, n)
+    vector<CallSite> calls;
+    int component = -1;            // strongly connected component in the call graph
+    bool recursive = false;        // calls itself, directly or through other functions
+    Recurrence recurrence;
+    RecurrenceSolution solution;
+    Cost cost;                     // cost of one call, memoized bottom-up over the call graph
+    bool cost_known = true;        // false when a recurrence on the way was unsolved
+    Cost space;                    // auxiliary memory allocated by the body itself
+    Cost peak_space;               // including callees and the recursion stack
+};
+
+// One step of a worst-case path: a line of a function
+struct PathStep {
+    int function;
+    int result_index;
+};
+
+// What one function costs and why: its worst-case complexity, the chain of
+// lines behind it (outer loop -> inner loop -> call -> the callee's own
+// chain) and the functions that call it
+struct FunctionSummary {
+    int function;                  // index into the analyzer's functions
+    vector<PathStep> worst_path;
+    vector<int> callers;
+};
+
+// Call graph over the functions of one analysis, in compressed sparse row
+// form: the callees of function i are targets[offsets[i]..offsets[i + 1]).
+// Strongly connected components come from an iterative Tarjan pass, so
+// memory and time stay linear in the size of the graph.
+class CallGraph {
+private:
+    vector<int> offsets;
+    vector<int> targets;
+    vector<int> component;        // SCC per function, numbered callees first
+    vector<int> component_size;
+    vector<bool> self_loop;
+
+    void compute_components() {
+        const int n = static_cast<int>(offsets.size()) - 1;
+        vector<int> index(n, -1), lowlink(n, 0);
+        vector<bool> on_stack(n, false);
+        vector<int> scc_stack;
+        vector<pair<int, int>> frames;  // (function, next edge) instead of recursion
+        int counter = 0;
+        component.assign(n, -1);
+
+        for (int root = 0; root < n; ++root) {
+            if (index[root] >= 0) continue;
+            index[root] = lowlink[root] = counter++;
+            scc_stack.push_back(root);
+            on_stack[root] = true;
+            frames.push_back({ root, offsets[root] });
+
+            while (!frames.empty()) {
+                int u = frames.back().first;
+                int& edge = frames.back().second;
+                if (edge < offsets[u + 1]) {
+                    int w = targets[edge++];
+                    if (index[w] < 0) {
+                        index[w] = lowlink[w] = counter++;
+                        scc_stack.push_back(w);
+                        on_stack[w] = true;
+                        frames.push_back({ w, offsets[w] });
+                    }
+                    else if (on_stack[w]) {
+                        lowlink[u] = min(lowlink[u], index[w]);
+                    }
+                    continue;
+                }
+
+                if (lowlink[u] == index[u]) {
+                    int id = static_cast<int>(component_size.size());
+                    int size = 0;
+                    int w;
+                    do {
+                        w = scc_stack.back();
+                        scc_stack.pop_back();
+                        on_stack[w] = false;
+                        component[w] = id;
+                        size++;
+                    } while (w != u);
+                    component_size.push_back(size);
+                }
+                frames.pop_back();
+                if (!frames.empty()) {
+                    int parent = frames.back().first;
+                    lowlink[parent] = min(lowlink[parent], lowlink[u]);
+                }
+            }
+        }
+    }
+
+public:
+    explicit CallGraph(const vector<FunctionInfo>& functions) {
+        const int n = static_cast<int>(functions.size());
+        offsets.assign(n + 1, 0);
+        self_loop.assign(n, false);
+        for (int i = 0; i < n; ++i) {
+            for (const auto& call : functions[i].calls) {
+                if (call.target < 0) continue;
+                targets.push_back(call.target);
+                if (call.target == i) self_loop[i] = true;
+            }
+            offsets[i + 1] = static_cast<int>(targets.size());
         }
+        compute_components();
     }
+
+    CallGraph() : offsets(1, 0) {}
+
+    int size() const { return static_cast<int>(self_loop.size()); }
+    int component_of(int function) const { return component[function]; }
+    int components() const { return static_cast<int>(component_size.size()); }
+
+    // A function is recursive when it calls itself or sits on a cycle
+    bool is_recursive(int function) const {
+        return self_loop[function] || component_size[component[function]] > 1;
+    }
+
+    const int* callees_begin(int function) const { return targets.data() + offsets[function]; }
+    const int* callees_end(int function) const { return targets.data() + offsets[function + 1]; }
 };
 
-// Print analysis results with colored ASCII formatting
-void print_results(const vector<CodeAnalysis>& results) {
-    cout << "\n" << BOLD << BLUE << "Line-by-Line Complexity Analysis:" << RESET << "\n";
-    cout << BOLD << "================================" << RESET << "\n";
+class ComplexityAnalyzer {
+private:
+    vector<string> code_lines;
+    AnalyzerOptions options;
+    unordered_map<string, int> function_calls;
+    unordered_set<string> defined_functions;
+    unordered_map<string, string> variable_types;  // variable -> std container kind
+    vector<bool> loop_lines;
+    vector<int> loop_parent;   // per line: result index of the innermost enclosing loop header
+    vector<FunctionSummary> summaries;
+    unordered_map<string, size_t> summary_index;
+    vector<Finding> findings;
+    vector<BlockFrame> block_stack;
+    string current_function;
+    bool in_block_comment = false;
+    bool in_directive = false;  // previous line was a directive ending in a backslash
+    size_t current_line = 0;    // index of the line being analyzed
+    Cost overall_cost;
+    Cost overall_space;
+    vector<FunctionInfo> functions;
+    CallGraph call_graph;
+    bool in_function = false;
 
-    for (const auto& result : results) {
-        cout << BOLD << "Line " << setw(3) << result.line_number << ": " << RESET
-            << WHITE << result.code << RESET << "\n";
-        cout << "  " << BOLD << GREEN << "->" << RESET << " Complexity: "
-            << ComplexityAnalyzer::complexity_to_string(result.complexity) << "\n";
-        cout << "  " << BOLD << YELLOW << "* " << RESET << "Reason: " << result.reason << "\n";
-        cout << BOLD << "--------------------------------" << RESET << "\n";
+    // if/else chain tracking: the latest chain per block depth and the
+    // branch a braceless if/else header hands to the next line
+    vector<int> last_chain;
+    int chain_count = 0;
+    int branch_count = 0;
+    int pending_chain = -1;
+    int pending_branch = -1;
+
+    // Parallel loops: OpenMP pragmas waiting for their loops (collapse(n)
+    // covers n of them) and the parallel loops currently open
+    int pending_parallel = 0;
+    vector<ParallelRegion> parallel_regions;
+
+    // Helper function to trim whitespace
+    static string trim(const string& str) {
+        static const regex pattern("^\\s+|\\s+$");
+        return regex_replace(str, pattern, "");
     }
-}
 
-// Print final complexity with colored ASCII formatting
-void print_final_complexity(Complexity complexity) {
-    cout << "\n" << BOLD << "================================" << RESET << "\n";
-    cout << BOLD << "Final Complexity: " << RESET
-        << ComplexityAnalyzer::complexity_to_string(complexity) << "\n";
-    cout << BOLD << "================================" << RESET << "\n";
-}
+    // Check if line is a comment
+    static bool is_comment(const string& line) {
+        return line.empty() || line.substr(0, 2) == "//";
+    }
 
-int main() {
-    // Set locale for consistent output
-    ios_base::sync_with_stdio(false);
-    locale::global(locale(""));
-    cout.imbue(locale());
+    // Strip one line of the code being analyzed, tracking block comments
+    string strip_comments(const string& line, vector<size_t>* origin = nullptr) {
+        return strip_comments(line, in_block_comment, origin);
+    }
 
-    cout << BOLD << CYAN << "C++ Time Complexity Analyzer" << RESET << "\n";
-    cout << BOLD << "Enter your code (type 'END' on a new line to finish):" << RESET << "\n\n";
+    // Number of loops enclosing the current line
+    int loop_depth() const {
+        return static_cast<int>(count_if(block_stack.begin(), block_stack.end(),
+            [](const BlockFrame& f) { return f.is_loop; }));
+    }
 
-    // Read input code
-    vector<string> code;
-    string line;
-    while (getline(cin, line) && line != "END") {
-        code.push_back(line);
+    // Index of the innermost enclosing loop whose induction variable is var
+    int find_loop_var(const string& var) const {
+        for (int k = static_cast<int>(block_stack.size()) - 1; k >= 0; --k) {
+            if (block_stack[k].is_loop && block_stack[k].var == var) return k;
+        }
+        return -1;
     }
 
-    // Analyze and display results
-    ComplexityAnalyzer analyzer(code);
-    auto results = analyzer.analyze();
-    print_results(results);
-    print_final_complexity(analyzer.estimate_overall_complexity());
+    // Work out which size a loop bound expression refers to: "n", "rows",
+    // "v.size()" -> v, or an outer induction variable (triangular loops).
+    // A container indexed by an outer induction variable, such as adj[u],
+    // or an outer range-for's element, such as list in for (auto& list :
+    // adj), sums to the total size |adj| over that loop; its frame index is
+    // returned through aggregated_over.
+    Cost size_of(string expr, int& aggregated_over) const {
+        static const regex cast(R"(^(?:static_cast\s*<[^>]*>|\(\s*(?:unsigned\s+)?[a-z_:]+\s*\)))");
+        static const regex trailing_constant(R"(^(.+?)\s*[-+*/]\s*\d+[uUlL]*$)");
+        static const regex integer(R"(^\d+[uUlL]*$)");
+        static const regex free_size(R"(^(?:std::)?(?:size|end|cend)\s*\((.+)\)$)");
+        static const regex member_size(R"(^(.+?)\s*(?:\.|->)\s*(?:size|length|end|cend)\s*\(\s*\)$)");
+        static const regex subscript(R"(^([A-Za-z_]\w*(?:(?:\.|->)[A-Za-z_]\w*)*)\s*\[\s*([A-Za-z_]\w*)\s*\]$)");
+        static const regex identifier(R"(^[A-Za-z_]\w*(?:(?:\.|->|::)[A-Za-z_]\w*)*$)");
 
-    return 0;
-}
\ No newline at end of file
+        aggregated_over = -1;
+        expr = trim(expr);
+        smatch m;
+        while (true) {
+            string before = expr;
+            expr = trim(regex_replace(expr, cast, ""));
+            if (expr.size() > 1 && expr.front() == '(' && expr.back() == ')') expr = trim(expr.substr(1, expr.size() - 2));
+            if (regex_match(expr, m, trailing_constant)) expr = trim(m[1].str());
+            if (regex_match(expr, m, free_size) || regex_match(expr, m, member_size)) expr = trim(m[1].str());
+            if (expr == before) break;
+        }
+        if (expr.compare(0, 6, "this->") == 0) expr = expr.substr(6);
+
+        if (regex_match(expr, integer)) return Cost();
+        if (regex_match(expr, m, subscript)) {
+            int k = find_loop_var(m[2].str());
+            if (k >= 0) {
+                aggregated_over = k;
+                return Cost::of_size("|" + m[1].str() + "|");
+            }
+            return Cost::of_size(m[1].str());
+        }
+        if (regex_match(expr, identifier)) {
+            int k = find_loop_var(expr);
+            if (k >= 0 && !block_stack[k].range.empty()) {
+                aggregated_over = k;
+                return Cost::of_size("|" + block_stack[k].range + "|");
+            }
+            if (k >= 0) return block_stack[k].bound;
+            return Cost::of_size(expr);
+        }
+        return Cost::of_size("n");
+    }
+
+    // Position of the ':' separating a range-based for declaration from its range
+    static size_t find_range_colon(const string& header) {
+        for (size_t i = 0; i < header.size(); ++i) {
+            if (header[i] != ':') continue;
+            if (i + 1 < header.size() && header[i + 1] == ':') { ++i; continue; }
+            if (i > 0 && header[i - 1] == ':') continue;
+            return i;
+        }
+        return string::npos;
+    }
+
+    // Text between the parenthesis at open and the one that closes it, or to
+    // the end of the line when it is not closed there. A body on the same
+    // line, as in for (int v : adj[u]) visit(v);, is not part of the header.
+    static string parenthesized(const string& code, size_t open) {
+        int depth = 0;
+        for (size_t i = open; i < code.size(); ++i) {
+            if (code[i] == '(') depth++;
+            else if (code[i] == ')' && --depth == 0) return code.substr(open + 1, i - open - 1);
+        }
+        return code.substr(open + 1);
+    }
+
+    // Bound of a classic for loop from its init and condition clauses
+    Cost classic_for_bound(const string& init, const string& cond, string& var, int& aggregated_over) const {
+        static const regex init_var(R"(([A-Za-z_]\w*)\s*=\s*([^,]+))");
+        static const regex comparison(R"(([A-Za-z_]\w*)\s*(<=|<|!=|>=|>)\s*([^&|]+))");
+        static const regex reversed(R"(([^&|<>!=]+?)\s*(<=|<|>=|>)\s*([A-Za-z_]\w*)\s*$)");
+
+        smatch m;
+        string start;
+        if (regex_search(init, m, init_var)) {
+            var = m[1].str();
+            start = m[2].str();
+        }
+        aggregated_over = -1;
+        if (regex_search(cond, m, comparison) && (var.empty() || m[1].str() == var)) {
+            var = m[1].str();
+            string op = m[2].str();
+            if (op == ">" || op == ">=") return start.empty() ? Cost::of_size("n") : size_of(start, aggregated_over);
+            return size_of(m[3].str(), aggregated_over);
+        }
+        if (regex_search(cond, m, reversed) && (var.empty() || m[3].str() == var)) {
+            var = m[3].str();
+            string op = m[2].str();
+            if (op == "<" || op == "<=") return start.empty() ? Cost::of_size("n") : size_of(start, aggregated_over);
+            return size_of(m[1].str(), aggregated_over);
+        }
+        return Cost::of_size("n");
+    }
+
+    // Whether the while loop on the current line bisects [lo, hi]: its body
+    // takes the midpoint of the two and moves one end to it
+    bool halves_interval(const string& lo, const string& hi) const {
+        static const regex midpoint(R"(\b([A-Za-z_]\w*)\s*=\s*(?:\(\s*([A-Za-z_]\w*)\s*\+\s*([A-Za-z_]\w*)\s*\)|)"
+            R"(([A-Za-z_]\w*)\s*\+\s*\(\s*([A-Za-z_]\w*)\s*-\s*([A-Za-z_]\w*)\s*\))\s*(?:/\s*2|>>\s*1)\b)");
+        static const regex copy(R"(\b([A-Za-z_]\w*)\s*=\s*([A-Za-z_]\w*)\b)");
+        string mid;
+        int depth = 0;
+        bool opened = false;
+        for (size_t j = current_line; j < code_lines.size(); ++j) {
+            const string& text = code_lines[j];
+            smatch m;
+            if (mid.empty() && regex_search(text, m, midpoint) &&
+                ((m[2].str() == lo && m[3].str() == hi) || (m[4].str() == lo && m[5].str() == hi && m[6].str() == lo))) {
+                mid = m[1].str();
+            }
+            if (!mid.empty() && contains_word(text, mid)) {
+                for (auto it = sregex_iterator(text.begin(), text.end(), copy); it != sregex_iterator(); ++it) {
+                    if (((*it)[1].str() == lo || (*it)[1].str() == hi) && (*it)[2].str() == mid) return true;
+                }
+            }
+            for (char c : text) {
+                if (c == '{') {
+                    depth++;
+                    opened = true;
+                }
+                else if (c == '}') depth--;
+            }
+            if (opened ? depth <= 0 : j > current_line) break;
+        }
+        return false;
+    }
+
+    // Size of the interval a bisection starts from: what its upper end was
+    // last set to before the loop in this function, e.g. v.size() - 1 -> v
+    Cost interval_size(const string& hi, int& aggregated_over) const {
+        static const regex assignment(R"(\b([A-Za-z_]\w*)\s*=\s*([^;,=][^;,]*))");
+        size_t first = in_function ? static_cast<size_t>(functions.back().first_line - 1) : 0;
+        for (size_t j = current_line; j-- > first;) {
+            const string& text = code_lines[j];
+            if (!contains_word(text, hi)) continue;
+            for (auto it = sregex_iterator(text.begin(), text.end(), assignment); it != sregex_iterator(); ++it) {
+                if ((*it)[1].str() == hi) return size_of((*it)[2].str(), aggregated_over);
+            }
+        }
+        return Cost::of_size(hi);
+    }
+
+    // Recognise a loop header and work out what bounds it. Fills in the
+    // frame's induction variable, its own bound and the total iterations of
+    // its body given the enclosing loops, plus a reason for the report.
+    bool parse_loop_header(const string& code, BlockFrame& frame, string& reason) const {
+        static const regex for_header(R"(\b(?:cilk_)?for\s*\()");
+        static const regex cilk_for(R"(\bcilk_for\s*\()");
+        static const regex parallel_call(R"(\b(?:tbb::)?(parallel_for|parallel_for_each|for_each|for_each_n)\s*\()");
+        static const regex blocked_range(R"(\bblocked_range\s*(?:<[^>]*>)?\s*\()");
+        static const regex lambda_param(R"(\[[^\]]*\]\s*\(\s*(?:const\s+)?(?:[\w:<>]+\s*[&*]*\s+)?&?\s*([A-Za-z_]\w*)\s*\))");
+        static const regex while_header(R"(\bwhile\s*\()");
+        static const regex do_header(R"(^do\b)");
+        static const regex do_while_tail(R"(^\}\s*while\s*\(.*\)\s*;$)");
+        static const regex not_empty(R"(!\s*(.+?)\s*(?:\.|->)\s*empty\s*\(\s*\))");
+        static const regex element_var(R"(([A-Za-z_]\w*)\s*$)");
+        static const regex interval(R"(^\s*([A-Za-z_]\w*)\s*(?:\+\s*1\s*)?(<=|<)\s*([A-Za-z_]\w*)\s*$)");
+
+        smatch m;
+        int aggregated_over = -1;
+        string bisected;  // [lo, hi] of a binary search loop
+        frame.is_loop = true;
+        if (regex_search(code, m, for_header)) {
+            string header = parenthesized(code, m.position(0) + m.length(0) - 1);
+            if (regex_search(code, cilk_for)) frame.parallel = "cilk_for";
+            size_t semi = header.find(';');
+            if (semi == string::npos) {
+                size_t colon = find_range_colon(header);
+                if (colon == string::npos) return false;
+                string decl = trim(header.substr(0, colon));
+                if (regex_search(decl, m, element_var)) frame.var = m[1].str();
+                frame.bound = size_of(header.substr(colon + 1), aggregated_over);
+                if (aggregated_over < 0 && !frame.bound.is_constant()) frame.range = frame.bound.expression();
+            }
+            else {
+                static const regex halving_step(R"((?:\*=|/=|<<=|>>=)\s*\d|=\s*[A-Za-z_]\w*\s*[*/]\s*\d)");
+                size_t second = header.find(';', semi + 1);
+                string cond = header.substr(semi + 1, second == string::npos ? string::npos : second - semi - 1);
+                frame.bound = classic_for_bound(header.substr(0, semi), cond, frame.var, aggregated_over);
+                if (second != string::npos && regex_search(header.substr(second + 1), halving_step)) {
+                    frame.bound = Cost::log_of(frame.bound);
+                }
+            }
+        }
+        else if (regex_search(code, do_while_tail)) {
+            return false;
+        }
+        else if (regex_search(code, m, while_header)) {
+            string cond = parenthesized(code, m.position(0) + m.length(0) - 1);
+            if (regex_search(cond, m, not_empty)) {
+                frame.bound = size_of(m[1].str(), aggregated_over);
+                frame.drains = trim(m[1].str());
+            }
+            else if (regex_match(cond, m, interval) && halves_interval(m[1].str(), m[3].str())) {
+                bisected = "[" + m[1].str() + ", " + m[3].str() + "]";
+                frame.bound = Cost::log_of(interval_size(m[3].str(), aggregated_over));
+            }
+            else {
+                frame.bound = classic_for_bound("", cond, frame.var, aggregated_over);
+            }
+        }
+        else if (regex_search(code, do_header)) {
+            frame.bound = Cost::of_size("n");
+        }
+        else if (regex_search(code, m, parallel_call) && code.find('[') != string::npos &&
+            count(code.begin(), code.end(), '{') > count(code.begin(), code.end(), '}')) {
+            // parallel_for(first, last, [&](int i) { ... }) and friends, with
+            // the lambda body on the following lines
+            size_t open = m.position(0) + m.length(0) - 1;
+            string name = m[1].str();
+            vector<string> args = split_args(call_arguments(code, open));
+            bool policy = !args.empty() && args[0].find("execution::par") != string::npos;
+            if (name.compare(0, 8, "for_each") == 0 && !policy) return false;
+            if (regex_search(code, m, lambda_param)) frame.var = m[1].str();
+            frame.parallel = policy ? "std::execution::par" : name;
+            if (policy) {
+                frame.bound = Cost::of_size(algorithm_size(code, open));
+            }
+            else if (!args.empty() && regex_search(args[0], m, blocked_range)) {
+                vector<string> range = split_args(call_arguments(args[0], m.position(0) + m.length(0) - 1));
+                frame.bound = size_of(range.size() > 1 ? range[1] : range[0], aggregated_over);
+            }
+            else {
+                frame.bound = size_of(args.size() > 2 ? args[1] : args.empty() ? "n" : args[0], aggregated_over);
+            }
+        }
+        else {
+            return false;
+        }
+
+        // Total iterations: multiply the enclosing bounds, except that an
+        // aggregated range replaces the bound of the loop it is indexed by
+        vector<string> factors;
+        Cost total;
+        for (int k = 0; k < static_cast<int>(block_stack.size()); ++k) {
+            const BlockFrame& outer = block_stack[k];
+            if (!outer.is_loop || k == aggregated_over) continue;
+            total = total * outer.bound;
+            if (!outer.bound.is_constant()) factors.push_back(outer.bound.expression());
+        }
+        frame.total = total * frame.bound;
+        if (!frame.bound.is_constant()) factors.push_back(frame.bound.expression());
+
+        if (frame.bound.is_constant()) {
+            reason = "Loop with a constant number of iterations";
+        }
+        else if (!bisected.empty() && factors.size() == 1) {
+            reason = "Loop bisecting " + bisected + " (" + factors[0] + " iterations)";
+        }
+        else if (frame.bound.classify() == Complexity::LOGARITHMIC && factors.size() == 1) {
+            reason = "Loop halving or doubling its counter (" + factors[0] + " iterations)";
+        }
+        else if (!frame.drains.empty() && factors.size() == 1) {
+            reason = "Loop drains " + frame.drains + ", one iteration per element pushed (" + factors[0] + " in total)";
+        }
+        else if (aggregated_over >= 0) {
+            reason = "Loop visits " + frame.bound.expression() + " elements in total across the loop over "
+                + block_stack[aggregated_over].var;
+        }
+        else if (factors.size() == 1) {
+            reason = "Single loop running " + factors[0] + " times";
+        }
+        else {
+            string product;
+            for (const auto& f : factors) product += (product.empty() ? "" : " × ") + f;
+            reason = (factors.size() == 2 ? "Nested loops (" : factors.size() == 3 ? "Triple nested loops (" : "Deeply nested loops (")
+                + product + " iterations)";
+        }
+        return true;
+    }
+
+    // Push and pop block frames for the braces on a line. A loop header
+    // without '{' gets a braceless frame that closes after its statement.
+    // Plain blocks opened on the line belong to the given if/else branch.
+    void update_blocks(const string& code, const BlockFrame* loop, int chain, int branch) {
+        static const regex scope_header(R"(\b(?:namespace|class|struct)(?:\s+([A-Za-z_]\w*))?[^;()]*\{)");
+        smatch m;
+        string scope;
+        if (regex_search(code, m, scope_header)) scope = m[1].matched ? m[1].str() : "(anonymous)";
+        bool pending = loop != nullptr;
+        for (char ch : code) {
+            if (ch == '{') {
+                if (pending) {
+                    block_stack.push_back(*loop);
+                    pending = false;
+                }
+                else if (!block_stack.empty() && block_stack.back().braceless) {
+                    block_stack.back().braceless = false;
+                }
+                else {
+                    BlockFrame frame;
+                    frame.chain = chain;
+                    frame.branch = branch;
+                    frame.scope = scope;
+                    scope.clear();
+                    block_stack.push_back(frame);
+                }
+            }
+            else if (ch == '}' && !block_stack.empty()) {
+                block_stack.pop_back();
+            }
+        }
+
+        bool ends_statement = !code.empty() && (code.back() == ';' || code.back() == '}');
+        if (pending) {
+            if (!ends_statement) {
+                BlockFrame frame = *loop;
+                frame.braceless = true;
+                block_stack.push_back(frame);
+            }
+            return;
+        }
+        if (ends_statement) {
+            while (!block_stack.empty() && block_stack.back().braceless) block_stack.pop_back();
+        }
+    }
+
+    // Name of a function defined at name_pos, qualified by the enclosing
+    // namespace and class blocks and by any Outer::Inner:: written before it
+    string qualified_name(const string& code, size_t name_pos, const string& name) const {
+        string qualifier;
+        size_t pos = name_pos;
+        while (pos >= 2 && code.compare(pos - 2, 2, "::") == 0) {
+            size_t end = pos - 2, begin = end;
+            while (begin > 0 && (isalnum(static_cast<unsigned char>(code[begin - 1])) || code[begin - 1] == '_')) begin--;
+            if (begin == end) break;
+            qualifier = code.substr(begin, end - begin) + "::" + qualifier;
+            pos = begin;
+        }
+        string scopes;
+        for (const auto& frame : block_stack) {
+            if (!frame.scope.empty()) scopes += frame.scope + "::";
+        }
+        return scopes + qualifier + name;
+    }
+
+    // Split a parenthesised argument list at top-level commas
+    static vector<string> split_args(const string& args) {
+        vector<string> out;
+        string current;
+        int depth = 0;
+        for (char ch : args) {
+            if (ch == '(' || ch == '[' || ch == '{') depth++;
+            if (ch == ')' || ch == ']' || ch == '}') depth--;
+            if (ch == ',' && depth == 0) {
+                out.push_back(trim(current));
+                current.clear();
+                continue;
+            }
+            current += ch;
+        }
+        if (!trim(current).empty()) out.push_back(trim(current));
+        return out;
+    }
+
+    // Parameter names from a definition's parameter list
+    static vector<string> parse_params(const string& params) {
+        static const regex param_name(R"(([A-Za-z_]\w*)\s*(?:\[[^\]]*\])?\s*$)");
+        vector<string> names;
+        for (string param : split_args(params)) {
+            param = param.substr(0, param.find('='));
+            smatch m;
+            if (regex_search(param, m, param_name) && m[1].str() != "void") names.push_back(m[1].str());
+        }
+        return names;
+    }
+
+    // How a self-call argument shrinks the input: n - 1, n / 2, mid,
+    // node->left or a slice such as s.substr(1). Slices also cost a copy.
+    pair<Shrink, double> classify_argument(const string& arg, const FunctionInfo& fn, string& size, bool& slices) const {
+        static const regex minus(R"(^([A-Za-z_]\w*)\s*-\s*(\d+)$)");
+        static const regex plus(R"(^([A-Za-z_]\w*)\s*\+\s*(\d+)$)");
+        static const regex divide(R"(^([A-Za-z_]\w*)\s*/\s*(\d+(?:\.\d+)?)$)");
+        static const regex scaled(R"(^(\d+)\s*\*\s*([A-Za-z_]\w*)\s*/\s*(\d+)$)");
+        static const regex shift(R"(^([A-Za-z_]\w*)\s*>>\s*(\d+)$)");
+        static const regex offset(R"(^([A-Za-z_]\w*)\s*[-+]\s*\d+$)");
+        static const regex slice(R"(^([A-Za-z_]\w*)?.*(?:\.substr\s*\(|\b(?:begin|end)\s*\(\s*\)\s*[-+]))");
+        static const regex halves(R"(/\s*2\b|>>\s*1\b)");
+        static const regex child(R"((?:->|\.)\s*(?:left|right|children\s*\[))");
+        static const regex next(R"((?:->|\.)\s*next\b)");
+
+        auto is_param = [&](const string& name) {
+            return find(fn.params.begin(), fn.params.end(), name) != fn.params.end();
+        };
+        auto is_halving = [&](const string& name) {
+            return find(fn.halving_vars.begin(), fn.halving_vars.end(), name) != fn.halving_vars.end();
+        };
+
+        smatch m;
+        string a = trim(arg);
+        if (regex_match(a, m, minus) && is_param(m[1].str())) {
+            size = m[1].str();
+            return { Shrink::SUBTRACT, stod(m[2].str()) };
+        }
+        if (regex_match(a, m, divide) && is_param(m[1].str())) {
+            size = m[1].str();
+            return { Shrink::DIVIDE, stod(m[2].str()) };
+        }
+        if (regex_match(a, m, scaled) && is_param(m[2].str())) {
+            size = m[2].str();
+            return { Shrink::DIVIDE, stod(m[3].str()) / stod(m[1].str()) };
+        }
+        if (regex_match(a, m, shift) && is_param(m[1].str())) {
+            size = m[1].str();
+            return { Shrink::DIVIDE, pow(2.0, stod(m[2].str())) };
+        }
+        if (is_halving(a) || (regex_match(a, m, offset) && is_halving(m[1].str()))) {
+            return { Shrink::DIVIDE, 2 };
+        }
+        if (regex_match(a, m, plus) && is_param(m[1].str())) {
+            // An index walking towards the size it is checked against, as
+            // in if (i >= n) return;, shrinks n - i. Without such a check,
+            // as with depth + 1, nothing says the recursion ends.
+            for (const auto& [param, bound] : fn.upper_bounds) {
+                if (param != m[1].str()) continue;
+                size = bound;
+                return { Shrink::SUBTRACT, stod(m[2].str()) };
+            }
+            return { Shrink::NONE, 0 };
+        }
+        if (regex_search(a, m, slice)) {
+            slices = true;
+            if (m[1].matched && is_param(m[1].str())) size = m[1].str();
+            bool halved = regex_search(a, halves) || any_of(fn.halving_vars.begin(), fn.halving_vars.end(),
+                [&](const string& v) { return contains_word(a, v); });
+            return halved ? make_pair(Shrink::DIVIDE, 2.0) : make_pair(Shrink::SUBTRACT, 1.0);
+        }
+        if (regex_search(a, child)) return { Shrink::DIVIDE, 2 };  // assumes a balanced tree
+        if (regex_search(a, next)) return { Shrink::SUBTRACT, 1 };
+        return { Shrink::NONE, 0 };
+    }
+
+    // Record the parameters an if condition checks against a size, as in
+    // if (i >= n) or if (s.size() == pos), for classify_argument
+    void record_upper_bounds(const string& code, FunctionInfo& fn) const {
+        static const regex if_header(R"(\bif\s*\()");
+        static const regex clause_split(R"(&&|\|\|)");
+        static const regex at_least(R"(^\s*([A-Za-z_]\w*)\s*(?:>=|==|>)\s*(.+?)\s*$)");
+        static const regex at_most(R"(^\s*(.+?)\s*(?:<=|==|<)\s*([A-Za-z_]\w*)\s*$)");
+        static const regex integer(R"(^\d+[uUlL]*$)");
+
+        smatch m;
+        if (!regex_search(code, m, if_header)) return;
+        string cond = parenthesized(code, m.position(0) + m.length(0) - 1);
+        for (auto it = sregex_token_iterator(cond.begin(), cond.end(), clause_split, -1); it != sregex_token_iterator(); ++it) {
+            string clause = it->str();
+            string param, bound;
+            if (regex_match(clause, m, at_least)) {
+                param = m[1].str();
+                bound = m[2].str();
+            }
+            else if (regex_match(clause, m, at_most)) {
+                param = m[2].str();
+                bound = m[1].str();
+            }
+            if (find(fn.params.begin(), fn.params.end(), param) == fn.params.end() || regex_match(trim(bound), integer)) continue;
+            int aggregated_over;
+            Cost size = size_of(bound, aggregated_over);
+            if (!size.is_constant()) fn.upper_bounds.push_back({ param, size.expression() });
+        }
+    }
+
+    // Record the calls on a line to functions defined or declared in the code
+    void record_calls(const string& code, size_t result_index, int chain, int branch) {
+        static const regex call_pattern(R"(\b([A-Za-z_]\w*)\s*\()");
+        static const regex keyword(R"(^(?:if|for|while|switch|catch|return|sizeof|alignof|decltype|static_assert)$)");
+
+        FunctionInfo& fn = functions.back();
+        for (auto it = sregex_iterator(code.begin(), code.end(), call_pattern); it != sregex_iterator(); ++it) {
+            string name = (*it)[1].str();
+            size_t pos = it->position(1);
+            if (regex_match(name, keyword)) continue;
+            if (function_calls.find(name) == function_calls.end() && (!options.headers || !options.headers->count(name))) continue;
+            if (pos > 0 && code[pos - 1] == '.') continue;
+            if (pos > 1 && code.compare(pos - 2, 2, "->") == 0 && (pos < 6 || code.compare(pos - 6, 6, "this->") != 0)) continue;
+
+            size_t open = code.find('(', pos + name.size());
+            int depth = 0;
+            size_t close = open;
+            for (; close < code.size(); ++close) {
+                if (code[close] == '(') depth++;
+                if (code[close] == ')' && --depth == 0) break;
+            }
+
+            CallSite call;
+            call.callee = name;
+            call.result_index = result_index;
+            call.chain = chain;
+            call.branch = branch;
+            size_t ret = code.rfind("return", pos);
+            if (ret != string::npos && code.find(';', ret) >= pos) call.statement = static_cast<int>(result_index) + 1;
+            for (auto frame = block_stack.rbegin(); frame != block_stack.rend() && frame - block_stack.rbegin() < static_cast<long>(block_stack.size() - fn.depth); ++frame) {
+                if (frame->is_loop) {
+                    call.loop_bound = frame->total;
+                    break;
+                }
+            }
+
+            string size;
+            call.args = split_args(code.substr(open + 1, close - open - 1));
+            for (const auto& arg : call.args) {
+                tie(call.shrink, call.amount) = classify_argument(arg, fn, size, call.slices);
+                if (call.shrink != Shrink::NONE) break;
+            }
+            if (!size.empty()) call.size = size;
+            fn.calls.push_back(call);
+        }
+    }
+
+    // Build the recurrence of a recursive function from its calls into its
+    // own strongly connected component, so a() -> b() -> a() counts too.
+    // Only one return statement runs per call, and only one branch of an
+    // if/else chain, so those count as alternatives rather than adding up.
+    void build_recurrence(FunctionInfo& fn) const {
+        Recurrence& r = fn.recurrence;
+        r.work = fn.work;
+        map<int, int> per_return;
+        map<int, map<int, int>> per_chain;
+        map<double, int> per_amount;
+        int unconditional = 0;
+        for (const auto& call : fn.calls) {
+            if (call.target < 0 || functions[call.target].component != fn.component) {
+                if (callee_of(call)) r.work = r.work + call_cost(call);
+                continue;
+            }
+            if (call.shrink == Shrink::NONE) {
+                r.unsolved = "cannot tell how the argument shrinks";
+            }
+            else if (r.shrink != Shrink::NONE && r.shrink != call.shrink) {
+                r.unsolved = "mixes n-c and n/b calls";
+            }
+            if (call.shrink != Shrink::NONE && r.shrink == Shrink::NONE) r.size = call.size;
+            if (call.slices) r.work = r.work + Cost::of_size(r.size);
+            r.branching = r.branching + call.loop_bound;
+            r.shrink = call.shrink;
+            per_amount[call.amount]++;
+
+            if (call.statement > 0) per_return[call.statement]++;
+            else if (call.chain < 0) unconditional++;
+            else per_chain[call.chain][call.branch]++;
+        }
+
+        int most_in_return = 0;
+        for (const auto& entry : per_return) most_in_return = max(most_in_return, entry.second);
+        r.calls = unconditional + most_in_return;
+        for (const auto& chain : per_chain) {
+            int most = 0;
+            for (const auto& branch : chain.second) most = max(most, branch.second);
+            r.calls += most;
+        }
+
+        if (!r.unsolved.empty()) return;
+        if (r.shrink == Shrink::SUBTRACT || per_amount.size() == 1) {
+            // The smallest reduction dominates: T(n-1) outweighs T(n-2)
+            r.parts = { { r.calls, per_amount.begin()->first } };
+        }
+        else {
+            for (const auto& entry : per_amount) r.parts.push_back({ entry.second, entry.first });
+        }
+    }
+
+    void finish_function(int last_line) {
+        functions.back().last_line = last_line;
+        in_function = false;
+        current_function.clear();
+    }
+
+    // Solve a recursive function's recurrence and annotate its recursive
+    // call lines, naming a few of the functions it recurses through
+    void solve_recursion(FunctionInfo& fn, const vector<int>& members, vector<CodeAnalysis>& results) {
+        build_recurrence(fn);
+        fn.solution = fn.recurrence.solve();
+
+        string partners;
+        int named = 0;
+        for (int member : members) {
+            if (functions[member].name == fn.name) continue;
+            if (++named > 3) {
+                partners += " and " + std::to_string(members.size() - 4) + " more";
+                break;
+            }
+            partners += (partners.empty() ? "" : ", ") + functions[member].name;
+        }
+        fn.cost = fn.solution.cost;
+        fn.cost_known = fn.solution.solved;
+
+        // Each level of the recursion keeps a stack frame and the body's own
+        // allocations alive. Halving recursions allocate a geometric series
+        // dominated by the first frame; shrinking by a constant keeps n frames.
+        const string& size = fn.recurrence.size;
+        fn.peak_space = fn.recurrence.shrink == Shrink::DIVIDE
+            ? Cost::log_of(Cost::of_size(size)) + fn.space
+            : Cost::of_size(size) * fn.space;
+        for (const auto& call : fn.calls) {
+            if (call.target < 0 ? call.external != nullptr : functions[call.target].component != fn.component) {
+                fn.peak_space = fn.peak_space + call_space(call);
+            }
+        }
+        Complexity complexity = fn.solution.solved ? fn.solution.cost.classify() : Complexity::UNKNOWN;
+        string reason = complexity_color(complexity) + (partners.empty() ? "" : "Mutually recursive with " + partners + "; ")
+            + "Recurrence " + fn.recurrence.to_string() + ", " + fn.solution.method + RESET;
+        for (const auto& call : fn.calls) {
+            if (call.target < 0 || functions[call.target].component != fn.component) continue;
+            CodeAnalysis& result = results[call.result_index];
+            result.complexity = complexity;
+            result.cost = fn.solution.cost;
+            result.reason = reason;
+        }
+        overall_cost = overall_cost + fn.solution.cost;
+    }
+
+    // Resolve call sites to definitions, build the call graph and solve
+    // every function that is recursive directly or through a cycle
+    void resolve_calls(vector<CodeAnalysis>& results) {
+        unordered_map<string, int> definitions;
+        for (int i = 0; i < static_cast<int>(functions.size()); ++i) definitions.emplace(functions[i].name, i);
+        for (auto& fn : functions) {
+            for (auto& call : fn.calls) {
+                auto it = definitions.find(call.callee);
+                call.target = it == definitions.end() ? -1 : it->second;
+                if (call.target < 0 && options.headers) {
+                    auto header = options.headers->find(call.callee);
+                    if (header != options.headers->end()) call.external = header->second;
+                }
+            }
+        }
+
+        call_graph = CallGraph(functions);
+        vector<vector<int>> members(call_graph.components());
+        for (int i = 0; i < call_graph.size(); ++i) {
+            functions[i].component = call_graph.component_of(i);
+            functions[i].recursive = call_graph.is_recursive(i);
+            members[functions[i].component].push_back(i);
+        }
+
+        // Components are numbered callees first, so walking them in order
+        // is a reverse topological order: every callee outside the current
+        // component already has its summary when its callers need it
+        for (const auto& component : members) {
+            for (int f : component) {
+                FunctionInfo& fn = functions[f];
+                if (fn.recursive) {
+                    solve_recursion(fn, component, results);
+                    continue;
+                }
+                fn.cost = fn.work;
+                fn.peak_space = fn.space;
+                for (const auto& call : fn.calls) {
+                    const FunctionInfo* callee = callee_of(call);
+                    if (!callee) continue;
+                    fn.cost = fn.cost + call_cost(call);
+                    fn.peak_space = fn.peak_space + call_space(call);
+                    fn.cost_known = fn.cost_known && callee->cost_known;
+                }
+            }
+        }
+
+        // Annotate lines that call into other components with the callee's cost
+        for (const auto& fn : functions) {
+            for (const auto& call : fn.calls) {
+                if (!callee_of(call) || (call.target >= 0 && functions[call.target].component == fn.component)) continue;
+                const FunctionInfo& callee = *callee_of(call);
+                CodeAnalysis& result = results[call.result_index];
+                if (loop_lines[call.result_index]) continue;
+
+                Cost cost = call_cost(call);
+                string reason = "Calls " + callee.name + " (" + (callee.cost_known ? callee.cost.to_string() : "unknown") + ")";
+                if (!call.loop_bound.is_constant()) reason += " inside loops running " + call.loop_bound.to_string() + " times";
+                bool first = result.cost.is_constant() && result.reason.find("Calls ") == string::npos;
+                result.cost = result.cost + cost;
+                result.complexity = callee.cost_known ? result.cost.classify() : Complexity::UNKNOWN;
+                result.reason = complexity_color(result.complexity) + (first ? reason : strip_colors(result.reason) + "; " + reason) + RESET;
+                overall_cost = overall_cost + cost;
+            }
+        }
+    }
+
+    // Definition a call resolves to, in this source or an included header
+    const FunctionInfo* callee_of(const CallSite& call) const {
+        return call.target >= 0 ? &functions[call.target] : call.external;
+    }
+
+    // Callee parameter -> caller argument size for one call site; constant
+    // arguments map to "" so terms in them drop out
+    unordered_map<string, string> argument_names(const CallSite& call) const {
+        static const regex argument_size(R"(^([A-Za-z_]\w*(?:(?:\.|->)[A-Za-z_]\w*)*)(?:\s*(?:\.|->)\s*(?:size|length)\s*\(\s*\))?(?:\s*[-+*/]\s*\d+)?$)");
+        static const regex integer(R"(^\d+[uUlL]*$)");
+
+        const FunctionInfo& callee = *callee_of(call);
+        unordered_map<string, string> names;
+        for (size_t i = 0; i < callee.params.size() && i < call.args.size(); ++i) {
+            smatch m;
+            if (regex_match(call.args[i], integer)) names[callee.params[i]] = "";
+            else if (regex_match(call.args[i], m, argument_size)) names[callee.params[i]] = m[1].str();
+        }
+        return names;
+    }
+
+    // Cost of one call site: the callee's summary, with its parameters
+    // renamed to the caller's argument sizes, times the enclosing loops
+    Cost call_cost(const CallSite& call) const {
+        return call.loop_bound * callee_of(call)->cost.rename(argument_names(call));
+    }
+
+    // Peak space of one call site. Calls run one after another and free
+    // their memory on return, so loops around the call do not multiply it.
+    Cost call_space(const CallSite& call) const {
+        return callee_of(call)->peak_space.rename(argument_names(call));
+    }
+
+    // Whether word occurs in text as a whole identifier
+    static bool contains_word(const string& text, const string& word) {
+        for (size_t pos = text.find(word); pos != string::npos; pos = text.find(word, pos + 1)) {
+            size_t end = pos + word.size();
+            if (pos > 0 && (isalnum(static_cast<unsigned char>(text[pos - 1])) || text[pos - 1] == '_')) continue;
+            if (end < text.size() && (isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_')) continue;
+            return true;
+        }
+        return false;
+    }
+
+    // Track function definitions in the code
+    void track_function_definitions() {
+        static const regex declaration(R"(\b([a-zA-Z_][a-zA-Z0-9_]*)\s*\([^)]*\)\s*(?:const)?\s*[{;])");
+        for (const auto& line : code_lines) {
+            smatch match;
+            if (regex_search(line, match, declaration)) {
+                function_calls[match[1].str()]++;
+                if (line.find('{', match.position(0)) != string::npos) defined_functions.insert(match[1].str());
+            }
+        }
+    }
+
+    // Remember the std container kind of declared variables and parameters,
+    // e.g. "unordered_map<int, string>& index" -> index: unordered_map
+    void record_declarations(const string& code) {
+        static const regex container(R"(\b(?:std::)?(vector|deque|list|map|multimap|set|multiset|unordered_map|unordered_set|string|priority_queue|queue|stack)\b)");
+        for (auto it = sregex_iterator(code.begin(), code.end(), container); it != sregex_iterator(); ++it) {
+            size_t pos = it->position(0) + it->length(0);
+            if (pos < code.size() && code.compare(pos, 2, "::") == 0) continue;
+            pos = code.find_first_not_of(" \t", pos);
+            if (pos != string::npos && code[pos] == '<') {
+                int depth = 0;
+                for (; pos < code.size(); ++pos) {
+                    if (code[pos] == '<') depth++;
+                    if (code[pos] == '>' && --depth == 0) break;
+                }
+                pos++;
+            }
+            pos = code.find_first_not_of(" \t&*", pos);
+            if (pos != string::npos && code.compare(pos, 5, "const") == 0) pos = code.find_first_not_of(" \t&*", pos + 5);
+            size_t end = pos;
+            while (end < code.size() && (isalnum(static_cast<unsigned char>(code[end])) || code[end] == '_')) end++;
+            if (end > pos) variable_types[code.substr(pos, end - pos)] = (*it)[1].str();
+        }
+    }
+
+    // Record a finding for code[pos, pos + length) on the given line
+    void add_finding(size_t line_index, const vector<size_t>& origin, size_t pos, size_t length,
+        const string& rule, const string& message, const string& suggestion, const Cost& cost) {
+        const string& raw = code_lines[line_index];
+        size_t indent = raw.find_first_not_of(" \t\r\n\f\v");
+        if (indent == string::npos || origin.empty()) return;
+        size_t last = min(pos + length, origin.size()) - 1;
+        findings.push_back({ static_cast<int>(line_index + 1),
+            static_cast<int>(indent + origin[min(pos, last)] + 1), static_cast<int>(indent + origin[last] + 1),
+            rule, message, suggestion, cost, loop_depth() });
+    }
+
+    // Assignments that copy a string into a new one to extend it, s = s + x
+    // or s = x + s; group 1 is the string
+    vector<smatch> string_rebuilds(const string& code) const {
+        static const regex rebuild(R"(\b([A-Za-z_]\w*)\s*=\s*(?:\1\s*\+|[^;=]*\+\s*\1\b(?!\s*[.(\[]))[^;]*)");
+        vector<smatch> found;
+        for (auto it = sregex_iterator(code.begin(), code.end(), rebuild); it != sregex_iterator(); ++it) {
+            size_t pos = it->position(0);
+            auto type = variable_types.find((*it)[1].str());
+            if (type == variable_types.end() || type->second != "string" || (pos > 0 && (code[pos - 1] == '.' || code[pos - 1] == '>'))) continue;
+            found.push_back(*it);
+        }
+        return found;
+    }
+
+    // Linear-time operations inside a loop make the loop effectively
+    // quadratic: erasing or inserting at the front of a vector or string,
+    // rebuilding a string with s = s + x, linear searches of a sequence,
+    // list::size (O(n) on the pre-C++11 libstdc++ ABI) and strlen
+    void find_hidden_quadratics(const string& code, size_t line_index, const vector<size_t>& origin) {
+        static const regex front_edit(R"(\b([A-Za-z_]\w*)\s*\.\s*(erase|insert)\s*\(\s*(?:\1\s*\.\s*c?begin\s*\(\s*\)|0\s*,))");
+        static const regex linear_search(R"((std::)?\b(find|find_if|find_if_not|count|count_if)\s*\(\s*(?:std::)?(?:c?begin\s*\(\s*)?([A-Za-z_]\w*)[^;]*?\))");
+        static const regex list_size(R"(\b([A-Za-z_]\w*)\s*(?:\.|->)\s*size\s*\(\s*\))");
+        static const regex c_length(R"(\bstrlen\s*\(\s*([A-Za-z_]\w*)\s*\))");
+
+        Cost loops = current_loop_total();
+        if (loops.is_constant()) return;
+        auto type_of = [&](const string& var) {
+            auto it = variable_types.find(var);
+            return it == variable_types.end() ? string() : it->second;
+        };
+        auto report = [&](const smatch& m, const string& var, const string& what, const string& suggestion) {
+            Cost cost = loops * Cost::of_size(var);
+            add_finding(line_index, origin, m.position(0), m.length(0), "hidden-quadratic",
+                what + " is " + Cost::of_size(var).to_string() + " inside loops running " + loops.to_string()
+                + " times: " + cost.to_string() + " in total", suggestion, cost);
+        };
+
+        for (auto it = sregex_iterator(code.begin(), code.end(), front_edit); it != sregex_iterator(); ++it) {
+            const smatch& m = *it;
+            string var = m[1].str(), type = type_of(var);
+            if (type != "vector" && type != "string") continue;
+            if (m[2].str() == "erase") {
+                report(m, var, type + "::erase at the front of " + var, type == "vector"
+                    ? "use a std::deque with pop_front, or advance a start index and erase once after the loop"
+                    : "advance a start index, or erase the consumed prefix once after the loop");
+            }
+            else {
+                report(m, var, type + "::insert at the front of " + var, type == "vector"
+                    ? "push_back and std::reverse once after the loop, or use std::deque::push_front"
+                    : "append and std::reverse once after the loop");
+            }
+        }
+        for (const auto& m : string_rebuilds(code)) {
+            string var = m[1].str();
+            report(m, var, "Rebuilding string " + var + " with +", "append in place with " + var + " += ... or "
+                + var + ".append(...), which is amortized O(1) per character");
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), linear_search); it != sregex_iterator(); ++it) {
+            const smatch& m = *it;
+            size_t pos = m.position(0);
+            if (!m[1].matched && (defined_functions.count(m[2].str()) ||
+                (pos > 0 && (code[pos - 1] == '.' || code[pos - 1] == '>' || code[pos - 1] == ':')))) continue;
+            string var = m[3].str(), type = type_of(var);
+            if (type != "vector" && type != "list" && type != "deque") continue;
+            report(m, var, "std::" + m[2].str() + " over " + type + " " + var,
+                "keep an unordered_set (or set) of the elements for O(1) lookups, or sort once and use std::binary_search");
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), list_size); it != sregex_iterator(); ++it) {
+            const smatch& m = *it;
+            string var = m[1].str();
+            if (type_of(var) != "list") continue;
+            report(m, var, "list::size on " + var + " (pre-C++11 ABI)",
+                "test " + var + ".empty() or keep the element count in a variable");
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), c_length); it != sregex_iterator(); ++it) {
+            const smatch& m = *it;
+            report(m, m[1].str(), "strlen(" + m[1].str() + ")", "compute the length once before the loop");
+        }
+    }
+
+    // Heap allocations repeated on every iteration of a loop: std::regex,
+    // std::string, container and std::function locals or temporaries,
+    // new/make_shared/make_unique, and by-value copies of containers.
+    // iterations and depth describe the loops the code runs under.
+    void find_loop_allocations(const string& code, size_t line_index, const vector<size_t>& origin,
+        const Cost& iterations, int depth) {
+        static const regex allocating_type(R"(\b(?:std::)?(w?regex|string|vector|function|deque|list|map|multimap|set|multiset|unordered_map|unordered_set)\b)");
+        static const regex heap_new(R"(\bnew\s+[A-Za-z_][\w:]*|\b(?:std::)?make_(?:shared|unique)\s*<)");
+        static const regex auto_copy(R"(\bauto\s+([A-Za-z_]\w*)\s*=\s*([A-Za-z_]\w*)\s*;)");
+
+        if (depth == 0 || code.compare(0, 6, "static") == 0) return;
+        string per_loop = " on every iteration of loops running " + iterations.to_string() + " times";
+        auto report = [&](size_t pos, size_t length, const string& what, const string& suggestion) {
+            add_finding(line_index, origin, pos, length, "loop-allocation", what + per_loop, suggestion, iterations);
+            findings.back().loop_depth = depth;
+        };
+        auto container_of = [&](const string& var) {
+            auto it = variable_types.find(var);
+            return it != variable_types.end() && it->second != "string";
+        };
+
+        for (auto it = sregex_iterator(code.begin(), code.end(), allocating_type); it != sregex_iterator(); ++it) {
+            size_t start = it->position(0);
+            size_t pos = start + it->length(0);
+            if (code.compare(pos, 2, "::") == 0) continue;
+            if (start > 0 && code[start - 1] == '<') continue;  // template argument, e.g. vector<string>
+            pos = code.find_first_not_of(" \t", pos);
+            if (pos != string::npos && code[pos] == '<') {
+                int nesting = 0;
+                for (; pos < code.size(); ++pos) {
+                    if (code[pos] == '<') nesting++;
+                    if (code[pos] == '>' && --nesting == 0) break;
+                }
+                pos = code.find_first_not_of(" \t", pos + 1);
+            }
+            if (pos == string::npos || code[pos] == '&' || code[pos] == '*' || code[pos] == ':') continue;
+
+            string type = (*it)[1].str();
+            string suggestion = type == "regex" || type == "wregex"
+                ? "make it static const or construct it once before the loop; compiling a regex costs far more than matching it"
+                : type == "function"
+                ? "take the callable as a template parameter or auto, or build the std::function once before the loop"
+                : "declare it before the loop and clear() it each iteration so its capacity is reused";
+            if (code[pos] == '(' || code[pos] == '{') {
+                report(start, pos + 1 - start, "Temporary std::" + type + " constructed", suggestion);
+                continue;
+            }
+            size_t end = pos;
+            while (end < code.size() && (isalnum(static_cast<unsigned char>(code[end])) || code[end] == '_')) end++;
+            if (end == pos) continue;
+            string name = code.substr(pos, end - pos);
+            size_t next = code.find_first_not_of(" \t", end);
+            if (next == string::npos || string("=({;,:").find(code[next]) == string::npos) continue;
+
+            if (code[next] == ':') {
+                report(start, end - start, "Range-for copies each std::" + type + " element " + name,
+                    "iterate by const reference: for (const auto& " + name + " : ...)");
+                continue;
+            }
+            size_t value = code.find_first_not_of(" \t", next + 1);
+            bool copies = code[next] == '=' && value != string::npos && container_of(code.substr(value, code.find_first_of(" \t;", value) - value));
+            report(start, end - start, copies
+                ? "Copy of container " + code.substr(value, code.find_first_of(" \t;", value) - value) + " into std::" + type + " " + name
+                : "std::" + type + " " + name + " constructed",
+                copies ? "bind a const reference instead of copying, or move from the source" : suggestion);
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), heap_new); it != sregex_iterator(); ++it) {
+            string what = it->str();
+            what = trim(what.back() == '<' ? what.substr(0, what.size() - 1) : what);
+            report(it->position(0), it->length(0), "Heap allocation " + what,
+                "keep the object by value, reuse one allocation across iterations, or draw from a pool");
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), auto_copy); it != sregex_iterator(); ++it) {
+            const smatch& m = *it;
+            if (!container_of(m[2].str())) continue;
+            report(m.position(0), m.length(0) - 1, "Copy of container " + m[2].str() + " into " + m[1].str(),
+                "bind const auto& " + m[1].str() + " instead of copying, or move from the source");
+        }
+    }
+
+    // Induction variables of the enclosing loops, outermost first; loops
+    // without a recognisable variable (while, do) leave an empty entry
+    vector<string> induction_vars() const {
+        vector<string> vars;
+        for (const auto& frame : block_stack) {
+            if (frame.is_loop) vars.push_back(frame.var);
+        }
+        return vars;
+    }
+
+    // Flag array accesses whose fastest-varying index is not the innermost
+    // loop variable: a[j][i] inside a j loop walks a column, and a[j * n + i]
+    // jumps n elements per iteration, so every access misses the cache line
+    void find_strided_access(const string& code, size_t line_index, const vector<size_t>& origin) {
+        vector<string> vars = induction_vars();
+        if (vars.size() < 2 || vars.back().empty()) return;
+        const string& inner = vars.back();
+        auto is_outer_var = [&](const string& text) {
+            for (size_t k = 0; k + 1 < vars.size(); ++k) {
+                if (!vars[k].empty() && vars[k] != inner && contains_word(text, vars[k])) return vars[k];
+            }
+            return string();
+        };
+
+        for (size_t pos = 0; pos < code.size(); ++pos) {
+            if (!(isalpha(static_cast<unsigned char>(code[pos])) || code[pos] == '_') ||
+                (pos > 0 && (isalnum(static_cast<unsigned char>(code[pos - 1])) || code[pos - 1] == '_'))) continue;
+            size_t end = pos;
+            while (end < code.size() && (isalnum(static_cast<unsigned char>(code[end])) || code[end] == '_')) end++;
+            string name = code.substr(pos, end - pos);
+
+            // Collect the chain of subscripts name[..][..]
+            vector<string> subscripts;
+            size_t next = end;
+            while (next < code.size() && code[next] == '[') {
+                int nesting = 0;
+                size_t close = next;
+                for (; close < code.size(); ++close) {
+                    if (code[close] == '[') nesting++;
+                    if (code[close] == ']' && --nesting == 0) break;
+                }
+                if (close == code.size()) break;
+                subscripts.push_back(code.substr(next + 1, close - next - 1));
+                next = close + 1;
+            }
+            if (subscripts.empty()) {
+                pos = end - 1;
+                continue;
+            }
+
+            string outer = is_outer_var(subscripts.back());
+            size_t inner_dim = subscripts.size();
+            for (size_t d = 0; d < subscripts.size(); ++d) {
+                if (contains_word(subscripts[d], inner)) inner_dim = d;
+            }
+            string access = code.substr(pos, next - pos);
+            if (subscripts.size() > 1 && inner_dim + 1 < subscripts.size() && !contains_word(subscripts.back(), inner)) {
+                add_finding(line_index, origin, pos, next - pos, "strided-access",
+                    access + " varies dimension " + to_string(inner_dim + 1) + " of " + to_string(subscripts.size())
+                    + " in the innermost loop over " + inner + ", so consecutive iterations are a whole row apart",
+                    outer.empty() ? "make " + inner + " index the last dimension, or transpose " + name
+                    : "swap the " + inner + " and " + outer + " loops so " + inner + " runs outermost, or transpose " + name,
+                    current_loop_total());
+            }
+            else if (subscripts.size() == 1) {
+                static const regex scaled_index(R"(^\s*([A-Za-z_]\w*)\s*\*\s*[A-Za-z_(]|[A-Za-z_)]\w*\s*\*\s*([A-Za-z_]\w*)\s*$)");
+                smatch m;
+                string index = subscripts.back();
+                size_t plus = index.find('+');
+                string stride_term = plus == string::npos ? index : index.substr(0, plus);
+                string other = plus == string::npos ? "" : index.substr(plus + 1);
+                bool strided = regex_search(stride_term, m, scaled_index) && (m[1].str() == inner || m[2].str() == inner);
+                if (!strided && !other.empty() && regex_search(other, m, scaled_index)) {
+                    strided = m[1].str() == inner || m[2].str() == inner;
+                    other = stride_term;
+                }
+                outer = is_outer_var(other);
+                if (strided && !outer.empty()) {
+                    add_finding(line_index, origin, pos, next - pos, "strided-access",
+                        access + " scales the innermost loop variable " + inner + " by a row stride, so consecutive iterations jump a whole row",
+                        "swap the " + inner + " and " + outer + " loops so " + outer + " varies fastest",
+                        current_loop_total());
+                }
+            }
+            pos = next - 1;
+        }
+    }
+
+    // Size of an allocation extent such as "n", "v.size()" or "rows * cols"
+    Cost extent_of(const string& expr) const {
+        Cost extent;
+        size_t start = 0;
+        int nesting = 0;
+        for (size_t i = 0; i <= expr.size(); ++i) {
+            if (i < expr.size() && (expr[i] == '(' || expr[i] == '[')) nesting++;
+            if (i < expr.size() && (expr[i] == ')' || expr[i] == ']')) nesting--;
+            if (i == expr.size() || (expr[i] == '*' && nesting == 0)) {
+                int aggregated_over;
+                extent = extent * size_of(expr.substr(start, i - start), aggregated_over);
+                start = i + 1;
+            }
+        }
+        return extent;
+    }
+
+    // Arguments of the call whose '(' is at open, up to the matching ')'
+    static string call_arguments(const string& code, size_t open) {
+        int nesting = 0;
+        for (size_t i = open; i < code.size(); ++i) {
+            if (code[i] == '(') nesting++;
+            if (code[i] == ')' && --nesting == 0) return code.substr(open + 1, i - open - 1);
+        }
+        return code.substr(open + 1);
+    }
+
+    // Size of one element built in place, e.g. the vector<int>(m) in
+    // grid.push_back(vector<int>(m)) or the inner vector of a 2D table
+    Cost element_extent(const string& args) const {
+        static const regex nested(R"(\b(?:std::)?(?:vector|string|deque)\s*(?:<.*>)?\s*\()");
+        smatch m;
+        if (!regex_search(args, m, nested)) return Cost();
+        vector<string> parts = split_args(call_arguments(args, m.position(0) + m.length(0) - 1));
+        return parts.empty() ? Cost() : extent_of(parts[0]);
+    }
+
+    // Elements of a container a line constructs with a size, "vector<int>
+    // w(n)", or from a range, "vector<int> w(v.begin(), v.end())"; what names
+    // it for a reason. A function definition returning a container constructs
+    // nothing.
+    Cost constructed_extent(const string& code, string& what) const {
+        static const regex sized_container(R"(\b(?:std::)?(vector|string|deque|list|unordered_map|unordered_set)\s*(?:<.*>)?\s*([A-Za-z_]\w*)\s*\()");
+        static const regex parameter(R"(^(?:const\s+)?[A-Za-z_][\w:<>,\s]*[\s&*]+[A-Za-z_]\w*$)");
+        smatch m;
+        if (!regex_search(code, m, sized_container)) return Cost();
+        size_t open = m.position(0) + m.length(0) - 1;
+        vector<string> args = split_args(call_arguments(code, open));
+        if (args.empty() || args[0].empty() || regex_match(args[0], parameter)) return Cost();
+        string size = args[0];
+        Cost elements;
+        if (args[0].find("begin") != string::npos) {
+            size = algorithm_size(code, open);
+            elements = Cost::of_size(size);
+        }
+        else elements = extent_of(args[0]) * (args.size() > 1 ? element_extent(args[1]) : Cost());
+        what = m[1].str() + " " + m[2].str() + " constructed with " + size + " elements";
+        return elements;
+    }
+
+    // Auxiliary memory a line allocates: containers constructed with a size,
+    // new[] and make_unique<T[]>, copies of containers, resize/assign/reserve,
+    // and elements added inside loops, which grow with the iteration count
+    Cost space_of(const string& code) const {
+        static const regex container_copy(R"(\b(?:std::)?(?:vector|string|deque|list|map|set|unordered_map|unordered_set)\s*(?:<.*>)?\s+[A-Za-z_]\w*\s*=\s*([A-Za-z_]\w*)\s*;)");
+        static const regex array_new(R"(\bnew\s+[\w:<>]+\s*\[([^\]]+)\]|make_unique\s*<[^>]*\[\]\s*>\s*\()");
+        static const regex sizing(R"(\b([A-Za-z_]\w*)\s*(?:\.|->)\s*(?:resize|assign|reserve)\s*\()");
+        static const regex growth(R"(\b([A-Za-z_]\w*)\s*(?:\.|->)\s*(?:push_back|emplace_back|push_front|emplace_front|push|emplace|insert|append)\s*\(|\b([A-Za-z_]\w*)\s*(\+=|\[[^\]]*\]\s*=[^=]))");
+
+        Cost space;
+        smatch m;
+        string constructed;
+        Cost elements = constructed_extent(code, constructed);
+        if (!constructed.empty()) space = space + elements;
+        else if (regex_search(code, m, container_copy) && variable_types.count(m[1].str())) {
+            space = space + Cost::of_size(m[1].str());
+        }
+        if (regex_search(code, m, array_new)) {
+            string extent = m[1].matched ? m[1].str() : call_arguments(code, m.position(0) + m.length(0) - 1);
+            space = space + extent_of(extent);
+        }
+        if (regex_search(code, m, sizing) && variable_types.count(m[1].str())) {
+            vector<string> args = split_args(call_arguments(code, m.position(0) + m.length(0) - 1));
+            if (!args.empty()) space = space + extent_of(args[0]);
+        }
+        Cost loops = current_loop_total();
+        if (!loops.is_constant() && regex_search(code, m, growth)) {
+            string var = m[1].matched ? m[1].str() : m[2].str();
+            auto type = variable_types.find(var);
+            bool grows = false;
+            if (type != variable_types.end()) {
+                if (m[1].matched) grows = true;
+                else if (m[3].str() == "+=") grows = type->second == "string";
+                else grows = type->second.find("map") != string::npos;  // m[key] = value
+            }
+            if (grows) {
+                Cost element = m[1].matched ? element_extent(call_arguments(code, m.position(0) + m.length(0) - 1)) : Cost();
+                space = space + loops * element;
+            }
+        }
+        return space;
+    }
+
+    // Work of one line per execution of the loop at block_stack[first]:
+    // the line's own work times the bounds of the loops in between
+    Cost work_below(size_t first, const Cost& line) const {
+        Cost work = line;
+        for (size_t k = first; k < block_stack.size(); ++k) {
+            if (block_stack[k].is_loop) work = work * block_stack[k].bound;
+        }
+        return work;
+    }
+
+    // Critical path of one line per execution of the loop at
+    // block_stack[first]: serial loops repeat it, parallel loops add the
+    // log-depth fork/join tree over their iterations
+    Cost span_below(size_t first, const Cost& line) const {
+        Cost span = line;
+        for (size_t k = block_stack.size(); k-- > first;) {
+            const BlockFrame& frame = block_stack[k];
+            if (!frame.is_loop) continue;
+            span = frame.parallel.empty() ? frame.bound * span : Cost::log_of(frame.bound) + span;
+        }
+        return span;
+    }
+
+    // Report a finished parallel loop on its header line
+    void close_parallel_region(const ParallelRegion& region, CodeAnalysis& header) const {
+        header.reason = complexity_color(header.complexity) + strip_colors(header.reason)
+            + "; parallel (" + region.kind + "): work " + region.work.to_string() + ", span " + region.span.to_string()
+            + ", parallelism " + parallelism_of(region.work, region.span) + RESET;
+    }
+
+    // Worst-case path of one function: its costliest line (the deepest one
+    // on ties), preceded by the loop headers around it and followed by the
+    // path of the callee it calls there. Callees outside the function's
+    // component are summarized first, so their paths are already built.
+    void build_worst_path(int f, const vector<CodeAnalysis>& results, vector<bool>& built) {
+        if (built[f]) return;
+        built[f] = true;
+        const FunctionInfo& fn = functions[f];
+        FunctionSummary& summary = summaries[f];
+
+        int worst = -1;
+        for (int line = fn.first_line; line < fn.last_line && line < static_cast<int>(results.size()); ++line) {
+            if (worst < 0 || results[line].cost.growth() >= results[worst].cost.growth()) worst = line;
+        }
+        if (worst < 0 || results[worst].cost.is_constant()) return;
+
+        vector<PathStep> chain;
+        for (int line = worst; line >= 0; line = loop_parent[line]) chain.push_back({ f, line });
+        reverse(chain.begin(), chain.end());
+        summary.worst_path = chain;
+
+        const CallSite* heaviest = nullptr;
+        for (const auto& call : fn.calls) {
+            if (call.result_index != static_cast<size_t>(worst) || call.target < 0 ||
+                functions[call.target].component == fn.component) continue;
+            if (!heaviest || call_cost(call).growth() > call_cost(*heaviest).growth()) heaviest = &call;
+        }
+        if (heaviest) {
+            build_worst_path(heaviest->target, results, built);
+            const auto& callee_path = summaries[heaviest->target].worst_path;
+            summary.worst_path.insert(summary.worst_path.end(), callee_path.begin(), callee_path.end());
+        }
+    }
+
+    // Per-function summaries, indexed by name (the first definition wins,
+    // as when resolving calls)
+    void build_summaries(const vector<CodeAnalysis>& results) {
+        summaries.assign(functions.size(), FunctionSummary());
+        summary_index.clear();
+        for (int f = 0; f < static_cast<int>(functions.size()); ++f) {
+            summaries[f].function = f;
+            summary_index.emplace(functions[f].name, f);
+        }
+        for (int f = 0; f < static_cast<int>(functions.size()); ++f) {
+            for (const auto& call : functions[f].calls) {
+                if (call.target < 0 || call.target == f) continue;
+                auto& callers = summaries[call.target].callers;
+                if (callers.empty() || callers.back() != f) callers.push_back(f);
+            }
+        }
+        vector<bool> built(functions.size(), false);
+        for (int f = 0; f < static_cast<int>(functions.size()); ++f) build_worst_path(f, results, built);
+    }
+
+    // Iterations of the loops around the current line
+    Cost current_loop_total() const {
+        for (auto it = block_stack.rbegin(); it != block_stack.rend(); ++it) {
+            if (it->is_loop) return it->total;
+        }
+        return Cost();
+    }
+
+    // Size a std algorithm works on, from its first argument: v.begin(), begin(v) or v
+    static string algorithm_size(const string& code, size_t open) {
+        static const regex range(R"(^\s*(?:std::)?(?:c?begin\s*\(\s*)?([A-Za-z_]\w*)(?:\s*(?:\.|->)\s*c?begin\s*\(\s*\))?)");
+        smatch m;
+        string args = code.substr(open + 1);
+        if (regex_search(args, m, range)) {
+            string name = m[1].str();
+            if (name != "execution") return name;
+            size_t comma = args.find(',');
+            string rest = comma == string::npos ? "" : args.substr(comma + 1);
+            if (regex_search(rest, m, range)) return m[1].str();
+        }
+        return "n";
+    }
+
+    // Cost of the standard library calls on a line from the built-in cost
+    // table: member calls on variables of a known container kind and std
+    // algorithms, containers constructed with a size, which initialize every
+    // element, and strings copied by s = s + x, each multiplied by the loops
+    // around the line. once and span receive the work and critical path of
+    // one execution of the line; algorithms given std::execution::par split
+    // a linear pass into a log-depth tree and a sort into log² n.
+    Cost std_call_cost(const string& code, string& reason, Cost& once, Cost& span) const {
+        static const regex member_call(R"(([A-Za-z_]\w*)\s*(?:\.|->)\s*([A-Za-z_]\w*)\s*\()");
+        static const regex algorithm_call(R"((std::)?\b([a-z_]+)\s*\()");
+
+        Cost cost;
+        Cost loops = current_loop_total();
+        auto add = [&](const StdCallCost& entry, const string& size, bool parallel) {
+            StdCost kind = options.worst_case ? entry.worst : entry.amortized;
+            Cost one = std_cost_of(kind, size);
+            Cost depth = !parallel ? one
+                : kind == StdCost::N_LOG_N || kind == StdCost::N_LOG2_N ? Cost::of_size(size, 0, 2)
+                : kind == StdCost::CONSTANT ? Cost() : Cost::of_size(size, 0, 1);
+            cost = cost + loops * one;
+            once = once + one;
+            span = span + depth;
+            reason += (reason.empty() ? "" : "; ") + string(entry.name) + " on " + size + " ("
+                + (options.worst_case ? "worst case " : entry.amortized == entry.worst ? "" : "amortized ") + one.to_string()
+                + (parallel ? ", in parallel with span " + depth.to_string() : "") + ")";
+        };
+
+        for (auto it = sregex_iterator(code.begin(), code.end(), member_call); it != sregex_iterator(); ++it) {
+            auto type = variable_types.find((*it)[1].str());
+            if (type == variable_types.end()) continue;
+            const StdCallCost* entry = find_std_call_cost(type->second + "::" + (*it)[2].str());
+            if (entry) add(*entry, (*it)[1].str(), false);
+        }
+        for (auto it = sregex_iterator(code.begin(), code.end(), algorithm_call); it != sregex_iterator(); ++it) {
+            size_t pos = it->position(0);
+            bool qualified = (*it)[1].matched;
+            if (!qualified && (defined_functions.count((*it)[2].str()) ||
+                (pos > 0 && (code[pos - 1] == '.' || code[pos - 1] == '>' || code[pos - 1] == ':')))) continue;
+            const StdCallCost* entry = find_std_call_cost("std::" + (*it)[2].str());
+            size_t open = pos + it->length(0) - 1;
+            if (entry) add(*entry, algorithm_size(code, open), call_arguments(code, open).find("execution::par") != string::npos);
+        }
+        for (const auto& m : string_rebuilds(code)) {
+            Cost one = Cost::of_size(m[1].str());
+            cost = cost + loops * one;
+            once = once + one;
+            span = span + one;
+            reason += (reason.empty() ? "" : "; ") + string("string ") + m[1].str() + " copied by + (" + one.to_string() + ")";
+        }
+        string constructed;
+        Cost one = constructed_extent(code, constructed);
+        if (!one.is_constant()) {
+            cost = cost + loops * one;
+            once = once + one;
+            span = span + one;
+            reason += (reason.empty() ? "" : "; ") + constructed + " (" + one.to_string() + ")";
+        }
+        if (!cost.is_constant() && !loops.is_constant()) reason += " inside loops running " + loops.to_string() + " times";
+        return cost;
+    }
+
+public:
+    explicit ComplexityAnalyzer(const vector<string>& code, AnalyzerOptions opts = {})
+        : code_lines(code), options(opts) {}
+
+    // Detect recursive function calls: func_name as a whole word followed by '('
+    static bool is_recursive(const string& line, const string& func_name) {
+        if (func_name.empty()) return false;
+        for (size_t pos = line.find(func_name); pos != string::npos; pos = line.find(func_name, pos + 1)) {
+            if (pos > 0 && (isalnum(static_cast<unsigned char>(line[pos - 1])) || line[pos - 1] == '_')) continue;
+            size_t next = line.find_first_not_of(" \t", pos + func_name.size());
+            if (next != string::npos && line[next] == '(') return true;
+        }
+        return false;
+    }
+
+    // Color used for each complexity class
+    static string complexity_color(Complexity c) {
+        switch (c) {
+        case Complexity::CONSTANT:     return GREEN;
+        case Complexity::LINEAR:       return YELLOW;
+        case Complexity::QUADRATIC:    return RED;
+        case Complexity::CUBIC:        return MAGENTA;
+        case Complexity::LINEARITHMIC: return CYAN;
+        case Complexity::LOGARITHMIC:  return BLUE;
+        case Complexity::EXPONENTIAL:  return string(BOLD) + RED;
+        default:                      return WHITE;
+        }
+    }
+
+    // Convert complexity enum to string with color
+    static string complexity_to_string(Complexity c) {
+        switch (c) {
+        case Complexity::CONSTANT:     return GREEN + string("O(1)") + RESET;
+        case Complexity::LINEAR:       return YELLOW + string("O(n)") + RESET;
+        case Complexity::QUADRATIC:    return RED + string("O(n²)") + RESET;
+        case Complexity::CUBIC:        return MAGENTA + string("O(n³)") + RESET;
+        case Complexity::LINEARITHMIC: return CYAN + string("O(n log n)") + RESET;
+        case Complexity::LOGARITHMIC:  return BLUE + string("O(log n)") + RESET;
+        case Complexity::EXPONENTIAL:  return BOLD RED + string("O(2^n)") + RESET;
+        default:                      return WHITE + string("Unknown") + RESET;
+        }
+    }
+
+    // Remove comments and the contents of string and character literals so
+    // braces and keywords inside them are ignored. Block comments may span lines;
+    // in_block_comment carries that state from one line to the next.
+    // If origin is given it receives the index in line of every kept character.
+    static string strip_comments(const string& line, bool& in_block_comment, vector<size_t>* origin = nullptr) {
+        string out;
+        vector<size_t> from;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (in_block_comment) {
+                if (line.compare(i, 2, "*/") == 0) {
+                    in_block_comment = false;
+                    ++i;
+                }
+                continue;
+            }
+            char ch = line[i];
+            if (ch == '/' && i + 1 < line.size() && line[i + 1] == '/') break;
+            if (ch == '/' && i + 1 < line.size() && line[i + 1] == '*') {
+                in_block_comment = true;
+                ++i;
+                continue;
+            }
+            out += ch;
+            from.push_back(i);
+            if (ch == '"' || ch == '\'') {
+                for (++i; i < line.size() && line[i] != ch; ++i) {
+                    if (line[i] == '\\') ++i;
+                }
+                if (i < line.size()) {
+                    out += ch;
+                    from.push_back(i);
+                }
+            }
+        }
+        if (origin) {
+            size_t first = out.find_first_not_of(" \t\r\n\f\v");
+            size_t last = out.find_last_not_of(" \t\r\n\f\v");
+            origin->assign(first == string::npos ? from.end() : from.begin() + first,
+                first == string::npos ? from.end() : from.begin() + last + 1);
+        }
+        return trim(out);
+    }
+
+    // Match a function definition header such as "int f(int n) {", with the
+    // name in match[1] and the parameter list in match[2]
+    static bool match_definition(const string& code, smatch& match) {
+        static const regex definition(R"(\b([a-zA-Z_][a-zA-Z0-9_]*)\s*\(([^)]*)\)\s*(?:const)?\s*[{])");
+        static const regex keyword(R"(^(?:if|for|while|switch|catch|return|sizeof|else|do)$)");
+        return regex_search(code, match, definition) && !regex_match(match[1].str(), keyword);
+    }
+
+    // Convert a symbolic cost to string with the color of its class
+    static string cost_to_string(const Cost& cost) {
+        return complexity_color(cost.classify()) + cost.to_string() + RESET;
+    }
+
+    // Drop ANSI color codes from an already formatted string
+    static string strip_colors(const string& text) {
+        static const regex color_code("\033\\[[0-9;]*m");
+        return regex_replace(text, color_code, "");
+    }
+
+    // Get explanation for the complexity with color
+    string get_complexity_reason(const string& line, Complexity complexity) const {
+        static const regex loop_keyword(R"(\b(for|while)\s*\()");
+        switch (complexity) {
+        case Complexity::CONSTANT:
+            return GREEN + string("Constant time operation (no loops)") + RESET;
+
+        case Complexity::LINEAR:
+            if (regex_search(line, loop_keyword)) {
+                return YELLOW + string("Single loop running n times") + RESET;
+            }
+            return YELLOW + string("Linear time operation") + RESET;
+
+        case Complexity::QUADRATIC:
+            return RED + string("Nested loops (n × n iterations)") + RESET;
+
+        case Complexity::CUBIC:
+            return MAGENTA + string("Triple nested loops (n × n × n iterations)") + RESET;
+
+        case Complexity::LINEARITHMIC:
+            return CYAN + string("Log-linear operation") + RESET;
+
+        case Complexity::LOGARITHMIC:
+            return BLUE + string("Logarithmic operation (halving the input)") + RESET;
+
+        case Complexity::EXPONENTIAL:
+            return BOLD RED + string("Branching recursion (exponential number of calls)") + RESET;
+
+        default:
+            return WHITE + string("Unable to determine complexity") + RESET;
+        }
+    }
+
+    // Analyze a single line of code
+    Complexity analyze_line(const string& line) {
+        if (is_comment(line)) return Complexity::CONSTANT;
+
+        // Check for loops
+        BlockFrame loop;
+        string loop_reason;
+        if (parse_loop_header(line, loop, loop_reason)) {
+            return loop.total.classify();
+        }
+
+        // Recursive calls are resolved per function from their recurrence
+        if (!current_function.empty() && is_recursive(line, current_function)) {
+            return Complexity::UNKNOWN;
+        }
+
+        // Check for function calls
+        static const regex function_call(R"(\b[a-zA-Z_][a-zA-Z0-9_]*\s*\([^)]*\)\s*;)");
+        if (regex_search(line, function_call)) {
+            return Complexity::UNKNOWN;
+        }
+
+        return Complexity::CONSTANT;
+    }
+
+    // Analyze the entire code
+    vector<CodeAnalysis> analyze() {
+        static const regex branch_start(R"(^(?:\}\s*)?(else\s+if|else|if)\b)");
+        static const regex halving_var(R"(\b([A-Za-z_]\w*)\s*=\s*[^;=]*(?:/\s*2\b|>>\s*1\b))");
+        static const regex taken_element(R"(\b([A-Za-z_]\w*)\s*=\s*([A-Za-z_][\w.]*(?:->[\w.]+)*)\s*(?:\.|->)\s*(?:front|top)\s*\(\s*\))");
+        static const regex omp_for(R"(^#\s*pragma\s+omp\s+(?:parallel\s+)?(?:for|taskloop)\b(?:.*\bcollapse\s*\(\s*(\d+)\s*\))?)");
+
+        vector<CodeAnalysis> results;
+        track_function_definitions();
+
+        for (size_t i = 0; i < code_lines.size(); ++i) {
+            string line = trim(code_lines[i]);
+            vector<size_t> origin;
+            string code = strip_comments(line, &origin);
+
+            // Preprocessor directives and their continuation lines are not
+            // code, so a loop in a #define opens no block; OpenMP pragmas
+            // stay for the loop they annotate
+            bool directive = in_directive || (!code.empty() && code[0] == '#');
+            in_directive = directive && !line.empty() && line.back() == '\\';
+            if (directive && !regex_search(code, omp_for)) code.clear();
+            current_line = i;
+
+            // The element a drain loop takes out, u in u = q.front(), indexes
+            // per-element ranges such as adj[u] the way an induction
+            // variable does, so work over them is amortized across the drain
+            smatch taken;
+            for (auto frame = block_stack.rbegin(); frame != block_stack.rend(); ++frame) {
+                if (!frame->is_loop) continue;
+                if (!frame->drains.empty() && frame->var.empty() && regex_search(code, taken, taken_element) &&
+                    taken[2].str() == frame->drains) {
+                    frame->var = taken[1].str();
+                }
+                break;
+            }
+
+            // Track function definitions
+            smatch match;
+            bool is_definition = false;
+            if (!in_function && match_definition(code, match)) {
+                FunctionInfo fn;
+                fn.name = match[1].str();
+                fn.qualified_name = qualified_name(code, match.position(1), fn.name);
+                fn.params = parse_params(match[2].str());
+                fn.first_line = static_cast<int>(i + 1);
+                fn.depth = block_stack.size();
+                functions.push_back(fn);
+                current_function = fn.name;
+                in_function = true;
+                is_definition = true;
+            }
+
+            // Work out which if/else branch the line belongs to
+            size_t base_depth = block_stack.size() - (!code.empty() && code[0] == '}' && !block_stack.empty() ? 1 : 0);
+            int chain = -1, branch = -1;
+            bool branch_header = regex_search(code, match, branch_start);
+            if (branch_header) {
+                if (last_chain.size() <= base_depth) last_chain.resize(base_depth + 1, -1);
+                if (match[1].str() == "if" || last_chain[base_depth] < 0) last_chain[base_depth] = ++chain_count;
+                chain = last_chain[base_depth];
+                branch = ++branch_count;
+            }
+            else if (pending_branch >= 0) {
+                chain = pending_chain;
+                branch = pending_branch;
+            }
+            else {
+                for (auto it = block_stack.rbegin(); it != block_stack.rend(); ++it) {
+                    if (it->chain >= 0) {
+                        chain = it->chain;
+                        branch = it->branch;
+                        break;
+                    }
+                }
+            }
+
+            // Loops report the iterations of their whole nest in named sizes
+            BlockFrame loop;
+            string loop_reason;
+            bool is_loop = parse_loop_header(code, loop, loop_reason);
+            loop.header = static_cast<int>(i);
+            if (is_loop && pending_parallel > 0) {
+                loop.parallel = "OpenMP";
+                pending_parallel--;
+            }
+            else if (regex_search(code, match, omp_for)) {
+                pending_parallel = match[1].matched ? stoi(match[1].str()) : 1;
+            }
+            else if (!code.empty() && code != "{") {
+                pending_parallel = 0;
+            }
+            Cost once, once_span;  // work and span of one execution of the line
+
+            CodeAnalysis result{ static_cast<int>(i + 1), line, Complexity::CONSTANT, "", Cost(), Cost() };
+            if (is_loop) {
+                result.cost = loop.total;
+                result.complexity = loop.total.classify();
+                result.reason = complexity_color(result.complexity) + loop_reason + RESET;
+                overall_cost = overall_cost + loop.total;
+                if (in_function) functions.back().work = functions.back().work + loop.total;
+            }
+            else {
+                result.complexity = is_definition ? Complexity::CONSTANT : analyze_line(code);
+                result.reason = get_complexity_reason(code, result.complexity);
+
+                string std_reason;
+                Cost std_cost = std_call_cost(code, std_reason, once, once_span);
+                if (!std_reason.empty()) {
+                    result.cost = std_cost;
+                    result.complexity = std_cost.classify();
+                    result.reason = complexity_color(result.complexity) + std_reason + RESET;
+                    overall_cost = overall_cost + std_cost;
+                    if (in_function) functions.back().work = functions.back().work + std_cost;
+                }
+            }
+            if (!is_loop) {
+                result.space = space_of(code);
+                if (in_function) functions.back().space = functions.back().space + result.space;
+                else overall_space = overall_space + result.space;
+            }
+            results.push_back(result);
+            loop_lines.push_back(is_loop);
+            loop_parent.push_back(-1);
+            for (auto it = block_stack.rbegin(); it != block_stack.rend(); ++it) {
+                if (it->is_loop) {
+                    loop_parent.back() = it->header;
+                    break;
+                }
+            }
+            if (is_loop && !loop.parallel.empty()) {
+                parallel_regions.push_back({ block_stack.size(), results.size() - 1, loop.parallel, loop.bound, Cost::log_of(loop.bound) });
+            }
+            else if (!is_loop) {
+                for (auto& region : parallel_regions) {
+                    region.work = region.work + work_below(region.frame, once);
+                    region.span = region.span + span_below(region.frame, once_span);
+                }
+            }
+            if (!is_loop) find_hidden_quadratics(code, i, origin);
+            if (!is_loop) find_strided_access(code, i, origin);
+            if (is_loop) find_loop_allocations(code, i, origin, loop.total, loop_depth() + 1);
+            else find_loop_allocations(code, i, origin, current_loop_total(), loop_depth());
+            record_declarations(code);
+
+            if (in_function && !is_definition) {
+                if (regex_search(code, match, halving_var)) functions.back().halving_vars.push_back(match[1].str());
+                record_upper_bounds(code, functions.back());
+                record_calls(code, results.size() - 1, chain, branch);
+            }
+
+            update_blocks(code, is_loop ? &loop : nullptr, chain, branch);
+            while (!parallel_regions.empty() && parallel_regions.back().frame >= block_stack.size()) {
+                close_parallel_region(parallel_regions.back(), results[parallel_regions.back().result_index]);
+                parallel_regions.pop_back();
+            }
+
+            bool open_header = !code.empty() && code.back() != ';' && code.back() != '{' && code.back() != '}';
+            pending_chain = branch_header && open_header ? chain : -1;
+            pending_branch = branch_header && open_header ? branch : -1;
+
+            if (in_function && block_stack.size() <= functions.back().depth) {
+                finish_function(static_cast<int>(i + 1));
+            }
+        }
+        if (in_function) finish_function(static_cast<int>(code_lines.size()));
+        resolve_calls(results);
+        build_summaries(results);
+        sort(findings.begin(), findings.end(), [](const Finding& a, const Finding& b) {
+            if (a.loop_depth != b.loop_depth) return a.loop_depth > b.loop_depth;
+            return make_pair(a.line_number, a.first_column) < make_pair(b.line_number, b.first_column);
+        });
+
+        return results;
+    }
+
+    // Functions found by the last analyze() call
+    const vector<string>& get_lines() const {
+        return code_lines;
+    }
+
+    const vector<FunctionInfo>& get_functions() const {
+        return functions;
+    }
+
+    // Performance findings from the last analyze() call, deepest loops first
+    const vector<Finding>& get_findings() const {
+        return findings;
+    }
+
+    // Per-function summaries from the last analyze() call, in definition order
+    const vector<FunctionSummary>& get_summaries() const {
+        return summaries;
+    }
+
+    // Summary of the function with the given name, or nullptr
+    const FunctionSummary* find_summary(const string& name) const {
+        auto it = summary_index.find(name);
+        return it == summary_index.end() ? nullptr : &summaries[it->second];
+    }
+
+    // Whether the given line is a loop header
+    bool is_loop_header(size_t result_index) const {
+        return loop_lines[result_index];
+    }
+
+    // Per line: result index of the innermost enclosing loop header, or -1
+    const vector<int>& get_loop_parents() const {
+        return loop_parent;
+    }
+
+    // Call graph between those functions
+    const CallGraph& get_call_graph() const {
+        return call_graph;
+    }
+
+    // Overall cost: the sum of every loop nest, e.g. O(V + |adj|)
+    const Cost& overall() const {
+        return overall_cost;
+    }
+
+    // Peak auxiliary space: top-level allocations plus each function's peak
+    Cost overall_space_peak() const {
+        Cost space = overall_space;
+        for (const auto& fn : functions) space = space + fn.peak_space;
+        return space;
+    }
+
+    // Estimate overall complexity class from the overall cost
+    Complexity estimate_overall_complexity() const {
+        return overall_cost.classify();
+    }
+};
+
+// Print exponential-time functions ahead of everything else: they are
+// the ones that turn into production timeouts
+void print_exponential_warnings(const vector<FunctionInfo>& functions) {
+    vector<const FunctionInfo*> exponential;
+    for (const auto& fn : functions) {
+        if (fn.solution.solved && fn.solution.cost.is_exponential()) exponential.push_back(&fn);
+    }
+    if (exponential.empty()) return;
+
+    cout << "\n" << BOLD << RED << "WARNING: Exponential-Time Functions:" << RESET << "\n";
+    cout << BOLD << "================================" << RESET << "\n";
+    for (const auto* fn : exponential) {
+        cout << BOLD << fn->name << RESET << " (lines " << fn->first_line << "-" << fn->last_line << "): "
+            << ComplexityAnalyzer::cost_to_string(fn->solution.cost) << "\n";
+        cout << "  " << BOLD << YELLOW << "* " << RESET << "Recurrence " << fn->recurrence.to_string()
+            << ", " << fn->solution.method << "\n";
+    }
+}
+
+// Print analysis results with colored ASCII formatting
+void print_results(const vector<CodeAnalysis>& results) {
+    cout << "\n" << BOLD << BLUE << "Line-by-Line Complexity Analysis:" << RESET << "\n";
+    cout << BOLD << "================================" << RESET << "\n";
+
+    for (const auto& result : results) {
+        cout << BOLD << "Line " << setw(3) << result.line_number << ": " << RESET
+            << WHITE << result.code << RESET << "\n";
+        cout << "  " << BOLD << GREEN << "->" << RESET << " Complexity: "
+            << (result.cost.is_constant() ? ComplexityAnalyzer::complexity_to_string(result.complexity)
+                : ComplexityAnalyzer::cost_to_string(result.cost)) << "\n";
+        if (!result.space.is_constant()) {
+            cout << "  " << BOLD << GREEN << "->" << RESET << " Space: " << ComplexityAnalyzer::cost_to_string(result.space) << "\n";
+        }
+        cout << "  " << BOLD << YELLOW << "* " << RESET << "Reason: " << result.reason << "\n";
+        cout << BOLD << "--------------------------------" << RESET << "\n";
+    }
+}
+
+// Print performance findings with their source spans and suggested fixes
+void print_findings(const vector<Finding>& findings) {
+    if (findings.empty()) return;
+
+    cout << "\n" << BOLD << MAGENTA << "Performance Findings:" << RESET << "\n";
+    cout << BOLD << "================================" << RESET << "\n";
+    for (const auto& finding : findings) {
+        cout << BOLD << "Line " << finding.line_number << ":" << finding.first_column << "-" << finding.last_column
+            << RESET << " [" << YELLOW << finding.rule << RESET << ", loop depth " << finding.loop_depth << "] "
+            << finding.message << "\n";
+        cout << "  " << BOLD << GREEN << "->" << RESET << " Suggestion: " << finding.suggestion << "\n";
+    }
+}
+
+// Print one summary per function: its own worst case, the chain of lines
+// that causes it, its peak space and its callers
+void print_function_summaries(const vector<FunctionSummary>& summaries, const vector<FunctionInfo>& functions,
+    const vector<CodeAnalysis>& results) {
+    if (summaries.empty()) return;
+
+    cout << "\n" << BOLD << BLUE << "Function Summaries:" << RESET << "\n";
+    cout << BOLD << "================================" << RESET << "\n";
+    for (const auto& summary : summaries) {
+        const FunctionInfo& fn = functions[summary.function];
+        cout << BOLD << fn.name << RESET << " (lines " << fn.first_line << "-" << fn.last_line << "): "
+            << (fn.cost_known ? ComplexityAnalyzer::cost_to_string(fn.cost) : ComplexityAnalyzer::complexity_to_string(Complexity::UNKNOWN))
+            << "\n";
+        for (const auto& step : summary.worst_path) {
+            const FunctionInfo& owner = functions[step.function];
+            cout << "  " << BOLD << GREEN << "->" << RESET << " "
+                << (step.function == summary.function ? "" : owner.name + " ")
+                << "line " << results[step.result_index].line_number << ": " << WHITE
+                << results[step.result_index].code << RESET << "\n";
+        }
+        if (!fn.peak_space.is_constant()) {
+            cout << "  " << BOLD << YELLOW << "* " << RESET << "Space: " << ComplexityAnalyzer::cost_to_string(fn.peak_space)
+                << (fn.recursive ? " including the recursion stack" : "") << "\n";
+        }
+        cout << "  " << BOLD << YELLOW << "* " << RESET << "Called by: ";
+        if (summary.callers.empty()) cout << "(none)";
+        for (size_t i = 0; i < summary.callers.size(); ++i) cout << (i ? ", " : "") << functions[summary.callers[i]].name;
+        cout << "\n";
+    }
+}
+
+// Print final complexity with colored ASCII formatting
+void print_final_complexity(const Cost& cost, const Cost& space) {
+    cout << "\n" << BOLD << "================================" << RESET << "\n";
+    cout << BOLD << "Final Complexity: " << RESET
+        << ComplexityAnalyzer::cost_to_string(cost) << "\n";
+    cout << BOLD << "Peak Auxiliary Space: " << RESET
+        << ComplexityAnalyzer::cost_to_string(space) << "\n";
+    cout << BOLD << "================================" << RESET << "\n";
+}
+
+// A function or outermost loop nest ranked in a repository-wide report
+struct Hotspot {
+    string file;
+    string function;
+    int first_line;
+    int last_line;
+    Cost cost;
+    string reason;
+    bool loop = false;  // an outermost loop nest rather than a whole function
+};
+
+// Whether a ranks above b: faster growth first, then by file and line so
+// the report is the same whatever order the workers finish in
+static bool hotter(const Hotspot& a, const Hotspot& b) {
+    auto ga = a.cost.growth(), gb = b.cost.growth();
+    if (ga != gb) return ga > gb;
+    return tie(a.file, a.first_line, a.function) < tie(b.file, b.first_line, b.function);
+}
+
+struct HotterOrder {
+    bool operator()(const Hotspot& a, const Hotspot& b) const { return hotter(a, b); }
+};
+
+// Bounded heap of the K hottest entries seen so far; the coolest is on top
+// so it is the one displaced
+using HotspotHeap = priority_queue<Hotspot, vector<Hotspot>, HotterOrder>;
+
+static void offer_hotspot(HotspotHeap& heap, Hotspot hotspot, size_t k) {
+    if (heap.size() < k) {
+        heap.push(move(hotspot));
+    }
+    else if (hotter(hotspot, heap.top())) {
+        heap.pop();
+        heap.push(move(hotspot));
+    }
+}
+
+// Call visit with each function and outermost loop nest of one analyzed
+// file whose cost grows with its input
+template <class Visit>
+static void for_each_hotspot(const string& file, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>& results, Visit visit) {
+    const auto& functions = analyzer.get_functions();
+    for (const auto& summary : analyzer.get_summaries()) {
+        const FunctionInfo& fn = functions[summary.function];
+        if (!fn.cost_known || fn.cost.is_constant()) continue;
+        // The reason on the function's own worst line, e.g. the call into a costly helper
+        string reason;
+        for (const auto& step : summary.worst_path) {
+            if (step.function == summary.function) reason = ComplexityAnalyzer::strip_colors(results[step.result_index].reason);
+        }
+        visit(Hotspot{ file, fn.name, fn.first_line, fn.last_line, fn.cost, reason });
+    }
+
+    const auto& parents = analyzer.get_loop_parents();
+    size_t owner = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (!analyzer.is_loop_header(i) || parents[i] >= 0 || results[i].cost.is_constant()) continue;
+        // The nest runs until the first line outside it and costs what its
+        // worst line does; the header alone counts only its own iterations
+        size_t last = i, worst = i;
+        for (size_t j = i + 1; j < results.size(); ++j) {
+            int up = parents[j];
+            while (up > static_cast<int>(i)) up = parents[up];
+            if (up != static_cast<int>(i)) break;
+            last = j;
+            if (results[j].cost.growth() > results[worst].cost.growth()) worst = j;
+        }
+        while (owner < functions.size() && functions[owner].last_line < results[i].line_number) owner++;
+        bool inside = owner < functions.size() && functions[owner].first_line <= results[i].line_number;
+        visit(Hotspot{ file, inside ? functions[owner].name : "(top level)", results[i].line_number,
+            results[last].line_number, results[worst].cost, ComplexityAnalyzer::strip_colors(results[worst].reason), true });
+    }
+}
+
+// Offer the functions and outermost loop nests of one analyzed file
+static void collect_hotspots(const string& file, const ComplexityAnalyzer& analyzer,
+    const vector<CodeAnalysis>& results, HotspotHeap& heap, size_t k) {
+    for_each_hotspot(file, analyzer, results, [&](Hotspot hotspot) { offer_hotspot(heap, move(hotspot), k); });
+}
+
+// C++ sources under the given files and directories, sorted
+static vector<string> collect_sources(const vector<string>& paths) {
+    static const unordered_set<string> extensions = { ".cpp", ".cc", ".cxx", ".c", ".h", ".hpp", ".hh", ".hxx", ".inl" };
+    vector<string> files;
+    for (const auto& path : paths) {
+        error_code ec;
+        if (filesystem::is_regular_file(path, ec)) {
+            files.push_back(path);
+            continue;
+        }
+        for (auto it = filesystem::recursive_directory_iterator(path, filesystem::directory_options::skip_permission_denied, ec);
+            it != filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) break;
+            string name = it->path().filename().string();
+            if (it->is_directory(ec) && !name.empty() && name[0] == '.') {
+                it.disable_recursion_pending();
+                continue;
+            }
+            if (it->is_regular_file(ec) && extensions.count(it->path().extension().string())) files.push_back(it->path().string());
+        }
+    }
+    sort(files.begin(), files.end());
+    files.erase(unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+static bool read_source(const string& file, vector<string>& lines) {
+    ifstream in(file, ios::binary);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        lines.push_back(move(line));
+    }
+    return true;
+}
+
+// The preprocessor --preprocess runs sources through, with its -D, -U and
+// -I flags
+struct Preprocessor {
+    string command = "c++ -E -w";
+    vector<string> flags;
+};
+
+// Set by --preprocess for the analyses of the run
+static const Preprocessor* preprocessor = nullptr;
+
+static string shell_quote(const string& text) {
+#ifdef _WIN32
+    return "\"" + text + "\"";
+#else
+    string quoted = "'";
+    for (char c : text) quoted += c == '\'' ? string("'\\''") : string(1, c);
+    return quoted + "'";
+#endif
+}
+
+// A line marker, "# 12 \"file\" 1" from cpp and gcc -E or "#line 12 \"file\""
+// from other preprocessors
+static bool parse_line_marker(const string& line, int& number, string& file) {
+    size_t pos = line.compare(0, 5, "#line") == 0 ? 5 : line.compare(0, 2, "# ") == 0 ? 2 : string::npos;
+    if (pos == string::npos) return false;
+    pos = line.find_first_not_of(' ', pos);
+    if (pos == string::npos || !isdigit(static_cast<unsigned char>(line[pos]))) return false;
+    number = atoi(line.c_str() + pos);
+    size_t open = line.find('"', pos);
+    if (open == string::npos) return false;
+    file.clear();
+    for (size_t i = open + 1; i < line.size() && line[i] != '"'; ++i) {
+        if (line[i] == '\\' && i + 1 < line.size()) ++i;
+        file += line[i];
+    }
+    return true;
+}
+
+// Run a source through the preprocessor and keep the expanded lines that
+// come from the source itself, each at the line its markers place it on.
+// Lines from included files are dropped as the output streams past and
+// lines in branches not taken stay blank, so memory is bounded by the
+// source rather than its expansion, and results need no mapping back.
+static bool preprocess_source(const string& file, vector<string>& lines, const vector<string>* build_flags) {
+    string command = preprocessor->command;
+    for (const auto& flag : preprocessor->flags) command += " " + shell_quote(flag);
+    if (build_flags) {
+        for (const auto& flag : *build_flags) command += " " + shell_quote(flag);
+    }
+    FILE* pipe = popen((command + " " + shell_quote(file)).c_str(), "r");
+    if (!pipe) return false;
+
+    char buffer[4096];
+    string line, main_file, marked;
+    bool in_source = false;
+    size_t number = 0;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        line += buffer;
+        if (line.back() != '\n' && !feof(pipe)) continue;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        int marker;
+        if (line[0] == '#' && parse_line_marker(line, marker, marked)) {
+            if (main_file.empty()) main_file = marked;
+            in_source = marked == main_file;
+            number = static_cast<size_t>(max(marker, 1));
+        }
+        else {
+            if (in_source && number > 0) {
+                if (lines.size() < number) lines.resize(number);
+                lines[number - 1] = move(line);
+            }
+            number++;
+        }
+        line.clear();
+    }
+    return pclose(pipe) == 0 && !main_file.empty();
+}
+
+// A source as the analyses see it: as written, or as --preprocess expands
+// it with the flags of the build it belongs to
+static bool load_source(const string& file, vector<string>& lines, const vector<string>* build_flags = nullptr) {
+    return preprocessor ? preprocess_source(file, lines, build_flags) : read_source(file, lines);
+}
+
+// One analyzed source kept by the daemon between requests
+struct AnalyzedSource {
+    filesystem::file_time_type modified;
+    uintmax_t size;
+    ComplexityAnalyzer analyzer;
+    vector<CodeAnalysis> results;
+
+    AnalyzedSource(const vector<string>& lines, const AnalyzerOptions& options, filesystem::file_time_type time, uintmax_t bytes)
+        : modified(time), size(bytes), analyzer(lines, options), results(analyzer.analyze()) {}
+};
+
+// Analyses of files keyed by absolute path and options. An entry is reused
+// while the file's size and modification time are unchanged; when the cache
+// is full the least recently used entry makes room.
+class AnalysisCache {
+    static constexpr size_t capacity = 8192;
+    mutex lock;
+    list<string> recency;  // keys, most recently used first
+    unordered_map<string, pair<shared_ptr<const AnalyzedSource>, list<string>::iterator>> entries;
+
+public:
+    shared_ptr<const AnalyzedSource> get(const string& file, const AnalyzerOptions& options) {
+        error_code error;
+        filesystem::path path = filesystem::absolute(file, error);
+        auto modified = filesystem::last_write_time(path, error);
+        uintmax_t size = error ? 0 : filesystem::file_size(path, error);
+        if (error) return nullptr;
+        string key = path.lexically_normal().string() + (options.worst_case ? "\n1" : "\n0");
+        {
+            lock_guard<mutex> guard(lock);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.first->modified == modified && it->second.first->size == size) {
+                recency.splice(recency.begin(), recency, it->second.second);
+                return it->second.first;
+            }
+        }
+        vector<string> lines;
+        if (!read_source(file, lines)) return nullptr;
+        auto source = make_shared<const AnalyzedSource>(lines, options, modified, size);
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            recency.splice(recency.begin(), recency, it->second.second);
+            it->second.first = source;
+            return source;
+        }
+        if (entries.size() >= capacity) {
+            entries.erase(recency.back());
+            recency.pop_back();
+        }
+        recency.push_front(key);
+        entries.emplace(key, make_pair(source, recency.begin()));
+        return source;
+    }
+};
+
+// Set by the daemon so analyses outlive a single request
+static AnalysisCache* analysis_cache = nullptr;
+
+// Run task(worker, index) for every index below count on a pool of workers
+// pulling indexes from a shared counter
+template <class Task>
+static void run_parallel(size_t count, size_t workers, Task task) {
+    atomic<size_t> next{ 0 };
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w] {
+            for (size_t i = next++; i < count; i = next++) task(w, i);
+        });
+    }
+    for (auto& worker : pool) worker.join();
+}
+
+// Analyses of headers by content and the functions they reach, so a header
+// copied under several paths is analyzed once. Workers look entries up far
+// more often than they add them, so lookups share the lock.
+class HeaderResults {
+    mutable shared_mutex lock;
+    unordered_map<uint64_t, shared_ptr<const AnalyzedSource>> entries;
+
+public:
+    shared_ptr<const AnalyzedSource> find(uint64_t hash) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = entries.find(hash);
+        return it == entries.end() ? nullptr : it->second;
+    }
+
+    // Keep source unless another worker stored the same content first,
+    // and return the analysis kept
+    shared_ptr<const AnalyzedSource> insert(uint64_t hash, shared_ptr<const AnalyzedSource> source) {
+        unique_lock<shared_mutex> guard(lock);
+        return entries.emplace(hash, move(source)).first->second;
+    }
+};
+
+// The sources of a run, from paths or a compile database, and the project
+// headers they include. Headers are analyzed once per content, each after
+// the headers it includes, and every analysis sees the functions of the
+// headers its file reaches, so a call into a header costs what that
+// header's analysis found.
+class IncludeGraph {
+    using HeaderFunctions = unordered_map<string, const FunctionInfo*>;
+    using Directives = vector<pair<string, bool>>;  // included name, quoted
+
+    // How a file is built: where its includes are looked up, and the flags
+    // --preprocess runs it with. A header takes those of the first file
+    // that reaches it.
+    struct Build {
+        vector<filesystem::path> dirs;
+        vector<string> flags;
+    };
+
+    struct Header {
+        filesystem::path path;
+        string name;               // as reported
+        shared_ptr<const Build> build;
+        vector<size_t> includes;   // headers it includes directly
+        int level = 0;             // longest include chain below it
+        shared_ptr<const AnalyzedSource> analysis;
+    };
+
+    struct Unit {
+        string name;
+        shared_ptr<const Build> build;
+        vector<size_t> includes;
+    };
+
+    filesystem::path cwd;
+    vector<Header> headers;
+    unordered_map<string, size_t> header_index;
+    vector<Unit> units;
+    unordered_map<string, shared_ptr<const Build>> unit_builds;
+    unordered_map<string, Directives> directives;
+    unordered_map<string, HeaderFunctions> unit_functions;
+    HeaderResults results;
+
+    string display(const filesystem::path& absolute) const {
+        return absolute.lexically_proximate(cwd).string();
+    }
+
+    const Directives& directives_of(const filesystem::path& source);
+    vector<size_t> includes_of(const filesystem::path& source, const shared_ptr<const Build>& build);
+    size_t add_header(const filesystem::path& path, const shared_ptr<const Build>& build);
+    void add_unit(const filesystem::path& source, const shared_ptr<const Build>& build);
+    int level_of(size_t header, vector<char>& state);
+    HeaderFunctions reachable_functions(const vector<size_t>& includes, int below) const;
+    void analyze(const AnalyzerOptions& options);
+
+public:
+    bool load_compile_commands(const string& path, const AnalyzerOptions& options, string& error);
+    void load_paths(const vector<string>& paths, const AnalyzerOptions& options);
+
+    // Units and headers, each once
+    vector<string> sources() const {
+        vector<string> files;
+        for (const auto& unit : units) files.push_back(unit.name);
+        for (const auto& header : headers) {
+            if (header.analysis) files.push_back(header.name);
+        }
+        return files;
+    }
+
+    const AnalyzedSource* header(const string& file) const {
+        auto it = header_index.find(file);
+        return it == header_index.end() ? nullptr : headers[it->second].analysis.get();
+    }
+
+    const HeaderFunctions* functions_for(const string& file) const {
+        auto it = unit_functions.find(file);
+        return it == unit_functions.end() ? nullptr : &it->second;
+    }
+
+    const vector<string>* preprocessor_flags_for(const string& file) const {
+        auto it = unit_builds.find(file);
+        return it == unit_builds.end() ? nullptr : &it->second->flags;
+    }
+};
+
+// Set by --include-graph or --compile-commands for the analyses of the run
+static const IncludeGraph* include_graph = nullptr;
+
+// Analyze files on a pool of workers. Each worker pulls the next file from
+// a shared counter and calls visit(worker, file index, analyzer, results)
+// on its own thread, or unreadable(file index) when the file cannot be
+// read; nothing is kept once visit returns. Returns the number of files
+// that could not be read.
+template <class Visit, class Unreadable>
+static size_t analyze_sources(const vector<string>& files, size_t workers, const AnalyzerOptions& options, Visit visit,
+    Unreadable on_unreadable) {
+    atomic<size_t> unreadable{ 0 };
+    run_parallel(files.size(), workers, [&](size_t w, size_t f) {
+        AnalyzerOptions file_options = options;
+        if (include_graph) {
+            if (const AnalyzedSource* header = include_graph->header(files[f])) {
+                visit(w, f, header->analyzer, header->results);
+                return;
+            }
+            file_options.headers = include_graph->functions_for(files[f]);
+        }
+        if (analysis_cache && !file_options.headers && !preprocessor) {
+            auto source = analysis_cache->get(files[f], file_options);
+            if (source) visit(w, f, source->analyzer, source->results);
+            else {
+                unreadable++;
+                on_unreadable(f);
+            }
+            return;
+        }
+        vector<string> lines;
+        if (!load_source(files[f], lines, include_graph ? include_graph->preprocessor_flags_for(files[f]) : nullptr)) {
+            unreadable++;
+            on_unreadable(f);
+            return;
+        }
+        ComplexityAnalyzer analyzer(lines, file_options);
+        auto results = analyzer.analyze();
+        visit(w, f, analyzer, results);
+    });
+    return unreadable;
+}
+
+template <class Visit>
+static size_t analyze_sources(const vector<string>& files, size_t workers, const AnalyzerOptions& options, Visit visit) {
+    return analyze_sources(files, workers, options, visit, [](size_t) {});
+}
+
+static size_t worker_count(size_t files) {
+    return max<size_t>(1, min<size_t>(thread::hardware_concurrency(), files));
+}
+
+// Analyze every source under paths on a pool of workers and print the K
+// hottest functions and loop nests. Each worker keeps its own bounded heap
+// and drops a file's results as soon as they are offered, so memory stays
+// at K hotspots per worker plus one file per worker.
+static int run_hotspot_report(const vector<string>& paths, size_t k, const AnalyzerOptions& options) {
+    vector<string> files = collect_sources(paths);
+    vector<HotspotHeap> heaps(worker_count(files.size()));
+    size_t unreadable = analyze_sources(files, heaps.size(), options,
+        [&](size_t worker, size_t f, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>& results) {
+            collect_hotspots(files[f], analyzer, results, heaps[worker], k);
+        });
+
+    HotspotHeap merged;
+    for (auto& heap : heaps) {
+        while (!heap.empty()) {
+            offer_hotspot(merged, heap.top(), k);
+            heap.pop();
+        }
+    }
+    vector<Hotspot> ranked;
+    while (!merged.empty()) {
+        ranked.push_back(merged.top());
+        merged.pop();
+    }
+    reverse(ranked.begin(), ranked.end());
+
+    cout << BOLD << CYAN << "Top " << ranked.size() << " Hotspots" << RESET << " across " << files.size() << " files\n";
+    cout << BOLD << "================================" << RESET << "\n";
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        const Hotspot& h = ranked[i];
+        cout << BOLD << setw(4) << i + 1 << ". " << RESET << ComplexityAnalyzer::cost_to_string(h.cost) << " "
+            << h.file << ":" << h.first_line << "-" << h.last_line << " in " << BOLD << h.function << RESET << "\n";
+        if (!h.reason.empty()) cout << "      " << BOLD << YELLOW << "* " << RESET << h.reason << "\n";
+    }
+    if (unreadable > 0) cerr << "Skipped " << unreadable << " unreadable files\n";
+    return 0;
+}
+
+// One function in a baseline: its cost, keyed by file and qualified name.
+// Line numbers are deliberately not part of the key, so moving a function
+// within its file does not count as a change.
+struct BaselineEntry {
+    string file;
+    string name;
+    bool known = true;
+    tuple<int, double, int> growth;
+    string cost;
+    Complexity complexity = Complexity::UNKNOWN;  // not stored in baseline files
+};
+
+static bool baseline_order(const BaselineEntry& a, const BaselineEntry& b) {
+    return tie(a.file, a.name) < tie(b.file, b.name);
+}
+
+// Baseline entries of one analyzed file, sorted by name. Overloads and
+// other repeated names get a #2, #3... suffix in definition order.
+static vector<BaselineEntry> baseline_entries(const string& file, const ComplexityAnalyzer& analyzer) {
+    vector<BaselineEntry> entries;
+    unordered_map<string, int> seen;
+    string key = filesystem::path(file).lexically_normal().generic_string();
+    for (const auto& fn : analyzer.get_functions()) {
+        int n = ++seen[fn.qualified_name];
+        BaselineEntry entry;
+        entry.file = key;
+        entry.name = n == 1 ? fn.qualified_name : fn.qualified_name + "#" + to_string(n);
+        entry.known = fn.cost_known;
+        entry.growth = fn.cost.growth();
+        entry.cost = fn.cost_known ? fn.cost.to_string() : "unknown";
+        entry.complexity = fn.cost_known ? fn.cost.classify() : Complexity::UNKNOWN;
+        entries.push_back(move(entry));
+    }
+    sort(entries.begin(), entries.end(), baseline_order);
+    return entries;
+}
+
+// Analyze paths into baseline entries sorted by file and name. Files are
+// visited in sorted order and each file's entries are sorted on their own,
+// so concatenating the per-file lists needs no global sort.
+static vector<BaselineEntry> analyze_baseline(const vector<string>& paths, const AnalyzerOptions& options) {
+    vector<string> files = collect_sources(paths);
+    vector<vector<BaselineEntry>> per_file(files.size());
+    analyze_sources(files, worker_count(files.size()), options,
+        [&](size_t, size_t f, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>&) {
+            per_file[f] = baseline_entries(files[f], analyzer);
+        });
+    vector<BaselineEntry> entries;
+    for (auto& file_entries : per_file) {
+        move(file_entries.begin(), file_entries.end(), back_inserter(entries));
+    }
+    if (!is_sorted(entries.begin(), entries.end(), baseline_order)) sort(entries.begin(), entries.end(), baseline_order);
+    return entries;
+}
+
+// Baseline format: a header line, then one tab-separated line per function:
+// file, qualified name, exponential rank (0 polynomial, 1 exponential,
+// 2 factorial), degree, log degree, cost.
+// Unknown costs have "-" in the three ranking columns.
+static const char* baseline_header = "# time complexity baseline v1";
+
+static bool write_baseline(const string& path, const vector<BaselineEntry>& entries) {
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+    out << baseline_header << "\n";
+    for (const auto& e : entries) {
+        out << e.file << '\t' << e.name << '\t';
+        if (e.known) out << get<0>(e.growth) << '\t' << format_number(get<1>(e.growth)) << '\t' << get<2>(e.growth);
+        else out << "-\t-\t-";
+        out << '\t' << e.cost << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+static bool read_baseline(const string& path, vector<BaselineEntry>& entries) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        vector<string> fields;
+        for (size_t start = 0;;) {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+            if (tab == string::npos) break;
+            start = tab + 1;
+        }
+        if (fields.size() != 6) return false;
+        BaselineEntry e;
+        e.file = fields[0];
+        e.name = fields[1];
+        e.known = fields[2] != "-";
+        if (e.known) e.growth = { atoi(fields[2].c_str()), atof(fields[3].c_str()), atoi(fields[4].c_str()) };
+        e.cost = fields[5];
+        entries.push_back(move(e));
+    }
+    if (!is_sorted(entries.begin(), entries.end(), baseline_order)) sort(entries.begin(), entries.end(), baseline_order);
+    return true;
+}
+
+// Compare a fresh analysis against a baseline in one merge pass over the
+// two sorted lists and report functions whose cost grew or shrank. Returns
+// 1 when anything regressed, so CI can fail the build.
+static int compare_baseline(const vector<BaselineEntry>& before, const vector<BaselineEntry>& after) {
+    vector<pair<const BaselineEntry*, const BaselineEntry*>> regressions, improvements;
+    size_t added = 0, removed = 0, compared = 0;
+    size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size()) {
+        if (j == after.size() || (i < before.size() && baseline_order(before[i], after[j]))) {
+            removed++;
+            i++;
+        }
+        else if (i == before.size() || baseline_order(after[j], before[i])) {
+            added++;
+            j++;
+        }
+        else {
+            const BaselineEntry& old_entry = before[i++];
+            const BaselineEntry& new_entry = after[j++];
+            compared++;
+            if (!old_entry.known || !new_entry.known) {
+                if (old_entry.known != new_entry.known) (new_entry.known ? improvements : regressions).push_back({ &old_entry, &new_entry });
+            }
+            else if (new_entry.growth > old_entry.growth) regressions.push_back({ &old_entry, &new_entry });
+            else if (new_entry.growth < old_entry.growth) improvements.push_back({ &old_entry, &new_entry });
+        }
+    }
+
+    auto print = [](const char* title, const char* color, const vector<pair<const BaselineEntry*, const BaselineEntry*>>& changes) {
+        if (changes.empty()) return;
+        cout << "\n" << BOLD << color << title << " (" << changes.size() << "):" << RESET << "\n";
+        cout << BOLD << "================================" << RESET << "\n";
+        for (const auto& change : changes) {
+            cout << change.second->file << " " << BOLD << change.second->name << RESET << ": "
+                << change.first->cost << " -> " << change.second->cost << "\n";
+        }
+    };
+    print("Regressions", RED, regressions);
+    print("Improvements", GREEN, improvements);
+    cout << "\nCompared " << compared << " functions (" << added << " added, " << removed << " removed)\n";
+    return regressions.empty() ? 0 : 1;
+}
+
+// Line span of one function definition, found without a full analysis
+struct FunctionSpan {
+    string name;
+    int first_line;  // 1-based, inclusive
+    int last_line;
+    size_t id = 0;   // stable across edits elsewhere in an IncrementalDocument
+};
+
+// Scanner state at the start of a line: the lexer state and the block
+// stack, kept as the brace depth and the depth the open definition started at
+struct ScanState {
+    bool in_block_comment = false;
+    bool in_directive = false;
+    int depth = 0;
+    int definition_depth = -1;  // -1 outside any definition
+
+    bool operator==(const ScanState& other) const {
+        return in_block_comment == other.in_block_comment && in_directive == other.in_directive && depth == other.depth &&
+            definition_depth == other.definition_depth;
+    }
+};
+
+// What scanning one line found, with the state it started in
+struct LineScan {
+    ScanState entry;
+    string definition;    // name of a definition starting on this line
+    bool closes = false;  // the open definition ends on this line
+};
+
+// Scan one line for definition headers and braces: the same headers
+// analyze() recognizes, but none of its costs
+static LineScan scan_line(const string& line, ScanState& state) {
+    LineScan scan;
+    scan.entry = state;
+    string code = ComplexityAnalyzer::strip_comments(line, state.in_block_comment);
+    size_t first = code.find_first_not_of(" \t");
+    bool directive = state.in_directive || (first != string::npos && code[first] == '#');
+    size_t last = line.find_last_not_of(" \t\r");
+    state.in_directive = directive && last != string::npos && line[last] == '\\';
+    if (directive) code.clear();
+    smatch match;
+    if (state.definition_depth < 0 && ComplexityAnalyzer::match_definition(code, match)) {
+        scan.definition = match[1].str();
+        state.definition_depth = state.depth;
+    }
+    for (char ch : code) {
+        if (ch == '{') state.depth++;
+        if (ch == '}' && state.depth > 0) state.depth--;
+    }
+    if (state.definition_depth >= 0 && state.depth <= state.definition_depth) {
+        scan.closes = true;
+        state.definition_depth = -1;
+    }
+    return scan;
+}
+
+static vector<FunctionSpan> spans_of(const vector<LineScan>& scans) {
+    vector<FunctionSpan> spans;
+    for (size_t i = 0; i < scans.size(); ++i) {
+        if (!scans[i].definition.empty()) spans.push_back({ scans[i].definition, static_cast<int>(i + 1), static_cast<int>(scans.size()) });
+        if (scans[i].closes && !spans.empty()) spans.back().last_line = static_cast<int>(i + 1);
+    }
+    return spans;
+}
+
+// Function definitions in a source, found by brace matching only
+static vector<FunctionSpan> function_spans(const vector<string>& lines) {
+    vector<LineScan> scans;
+    ScanState state;
+    for (const auto& line : lines) scans.push_back(scan_line(line, state));
+    return spans_of(scans);
+}
+
+// A document edited in place by (offset, removed length, inserted text)
+// edits. Each line keeps the scanner state it starts in; an edit rescans
+// from its first line until a line's new entry state matches the one it
+// had before, since from there on every scan would repeat. Only the
+// function spans overlapping the rescanned lines are rebuilt; the ones
+// after them just move, and keep their ids. Lines keep a trailing '\r' so
+// offsets match the text as sent.
+class IncrementalDocument {
+    vector<string> text;
+    vector<size_t> starts;  // offset of each line
+    vector<LineScan> scans;
+    vector<FunctionSpan> functions;  // in line order
+    size_t next_id = 1;
+    vector<size_t> added, dropped;   // span ids since the last take_edits()
+
+    // Rebuild the spans of the old lines [first, old_last), now the lines
+    // [first, last), with delta lines added after them
+    void update_spans(size_t first, size_t last, size_t old_last, ptrdiff_t delta) {
+        auto lo = partition_point(functions.begin(), functions.end(),
+            [&](const FunctionSpan& s) { return static_cast<size_t>(s.last_line) <= first; });
+        auto hi = partition_point(lo, functions.end(),
+            [&](const FunctionSpan& s) { return static_cast<size_t>(s.first_line - 1) < old_last; });
+        size_t start = first, end = last;
+        if (lo != hi) {
+            start = min(start, static_cast<size_t>(lo->first_line - 1));
+            end = max(end, static_cast<size_t>((hi - 1)->last_line + delta));
+        }
+        vector<FunctionSpan> rebuilt;
+        for (size_t i = start; i < end; ++i) {
+            if (!scans[i].definition.empty()) {
+                rebuilt.push_back({ scans[i].definition, static_cast<int>(i + 1), static_cast<int>(scans.size()), next_id++ });
+                added.push_back(rebuilt.back().id);
+            }
+            if (scans[i].closes && !rebuilt.empty()) rebuilt.back().last_line = static_cast<int>(i + 1);
+        }
+        for (auto it = lo; it != hi; ++it) dropped.push_back(it->id);
+        for (auto it = hi; it != functions.end(); ++it) {
+            it->first_line += static_cast<int>(delta);
+            it->last_line += static_cast<int>(delta);
+        }
+        size_t at = static_cast<size_t>(lo - functions.begin());
+        functions.erase(lo, hi);
+        functions.insert(functions.begin() + static_cast<ptrdiff_t>(at), rebuilt.begin(), rebuilt.end());
+    }
+
+public:
+    explicit IncrementalDocument(const string& initial = "") : text(1), starts(1, 0), scans(1) {
+        replace(0, 0, initial);
+    }
+
+    const vector<string>& lines() const { return text; }
+    const vector<FunctionSpan>& spans() const { return functions; }
+
+    // Ids of the spans built and of the spans dropped since the last call
+    pair<vector<size_t>, vector<size_t>> take_edits() {
+        pair<vector<size_t>, vector<size_t>> edits = { move(added), move(dropped) };
+        added.clear();
+        dropped.clear();
+        return edits;
+    }
+    size_t size() const { return starts.back() + text.back().size(); }
+    size_t offset_of(size_t line, size_t byte) const {
+        line = min(line, text.size() - 1);
+        return starts[line] + min(byte, text[line].size());
+    }
+
+    // Apply one edit; returns the lines [first, last) that were rescanned
+    pair<size_t, size_t> replace(size_t offset, size_t removed, const string& inserted) {
+        offset = min(offset, size());
+        removed = min(removed, size() - offset);
+        size_t first = static_cast<size_t>(upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+        size_t last = static_cast<size_t>(upper_bound(starts.begin(), starts.end(), offset + removed) - starts.begin()) - 1;
+        string joined = text[first].substr(0, offset - starts[first]) + inserted + text[last].substr(offset + removed - starts[last]);
+
+        vector<string> pieces;
+        for (size_t start = 0;;) {
+            size_t end = joined.find('\n', start);
+            pieces.push_back(joined.substr(start, end == string::npos ? string::npos : end - start));
+            if (end == string::npos) break;
+            start = end + 1;
+        }
+        ScanState state = scans[first].entry;
+        size_t count = pieces.size();
+        text.erase(text.begin() + first, text.begin() + last + 1);
+        text.insert(text.begin() + first, make_move_iterator(pieces.begin()), make_move_iterator(pieces.end()));
+        scans.erase(scans.begin() + first, scans.begin() + last + 1);
+        scans.insert(scans.begin() + first, count, LineScan());
+        starts.resize(text.size());
+        for (size_t i = first + 1; i < text.size(); ++i) starts[i] = starts[i - 1] + text[i - 1].size() + 1;
+
+        size_t i = first;
+        for (; i < text.size(); ++i) {
+            if (i >= first + count && scans[i].entry == state) break;
+            scans[i] = scan_line(text[i], state);
+        }
+        ptrdiff_t delta = static_cast<ptrdiff_t>(count) - static_cast<ptrdiff_t>(last - first + 1);
+        update_spans(first, i, static_cast<size_t>(static_cast<ptrdiff_t>(i) - delta), delta);
+        return { first, i };
+    }
+};
+
+// Add to keep every function the kept ones call, directly or not, so an
+// analysis of just the kept functions still sees the cost of each call
+static void add_callees(const vector<string>& lines, const vector<FunctionSpan>& spans, vector<bool>& keep) {
+    vector<size_t> work;
+    for (size_t k = 0; k < spans.size(); ++k) {
+        if (keep[k]) work.push_back(k);
+    }
+    while (!work.empty()) {
+        const FunctionSpan& span = spans[work.back()];
+        work.pop_back();
+        for (size_t k = 0; k < spans.size(); ++k) {
+            if (keep[k]) continue;
+            for (int line = span.first_line; line <= span.last_line; ++line) {
+                if (ComplexityAnalyzer::is_recursive(lines[line - 1], spans[k].name)) {
+                    keep[k] = true;
+                    work.push_back(k);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Run a shell command and capture its standard output
+static bool run_command(const string& command, string& output) {
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) return false;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) output.append(buffer, n);
+    return pclose(pipe) == 0;
+}
+
+// A path from a diff header, without git's quoting of unusual names
+static string unquote_diff_path(const string& path) {
+    if (path.size() < 2 || path.front() != '"' || path.back() != '"') return path;
+    string out;
+    for (size_t i = 1; i + 1 < path.size(); ++i) {
+        if (path[i] != '\\' || i + 2 >= path.size()) {
+            out += path[i];
+            continue;
+        }
+        char c = path[++i];
+        if (c >= '0' && c <= '7' && i + 2 < path.size() - 1) {
+            out += static_cast<char>(stoi(path.substr(i, 3), nullptr, 8));
+            i += 2;
+        }
+        else out += c == 'n' ? '\n' : c == 't' ? '\t' : c;
+    }
+    return out;
+}
+
+// New-file line ranges touched by each file of a unified diff, keyed by
+// the path on its +++ line as written, prefix included. Pure deletions
+// mark the line they were removed before.
+static map<string, vector<pair<int, int>>> parse_unified_diff(const string& diff) {
+    static const regex hunk(R"(^@@ -\d+(?:,\d+)? \+(\d+)(?:,(\d+))? @@)");
+    map<string, vector<pair<int, int>>> changed;
+    string file;
+    istringstream in(diff);
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        smatch m;
+        if (line.compare(0, 4, "+++ ") == 0) {
+            file = line.substr(4);
+            size_t tab = file.find('\t');
+            if (tab != string::npos) file.erase(tab);
+            file = unquote_diff_path(file);
+            if (file == "/dev/null") file.clear();
+        }
+        else if (!file.empty() && regex_search(line, m, hunk)) {
+            int first = stoi(m[1].str());
+            int count = m[2].matched ? stoi(m[2].str()) : 1;
+            changed[file].push_back({ max(first, 1), max(first, 1) + max(count, 1) - 1 });
+        }
+    }
+    return changed;
+}
+
+// A source taking part in a diff-scoped analysis and the role of each of
+// its functions in it
+struct ScopedSource {
+    vector<string> lines;
+    vector<FunctionSpan> spans;
+    map<size_t, string> roles;  // span index -> "changed" or "caller"
+};
+
+// Analyze only the functions a diff touches plus their direct callers. The
+// selected functions and the same-file functions they call are copied into
+// an otherwise blank source, so line numbers are kept and everything else
+// costs nothing to skip. Callers in other files are found with git grep
+// when the tree is a git checkout, and in the changed files otherwise.
+static int run_diff_scoped(const string& diff, const AnalyzerOptions& options) {
+    static const unordered_set<string> extensions = { ".cpp", ".cc", ".cxx", ".c", ".h", ".hpp", ".hh", ".hxx", ".inl" };
+    string toplevel;
+    if (run_command("git rev-parse --show-toplevel 2>" NULL_DEVICE, toplevel)) {
+        while (!toplevel.empty() && isspace(static_cast<unsigned char>(toplevel.back()))) toplevel.pop_back();
+    }
+
+    map<string, ScopedSource> sources;
+    auto load = [&](const string& file) -> ScopedSource* {
+        auto it = sources.find(file);
+        if (it != sources.end()) return &it->second;
+        ScopedSource source;
+        // Diff and git grep paths are relative to the top level of the checkout
+        if ((toplevel.empty() || !read_source(toplevel + "/" + file, source.lines)) && !read_source(file, source.lines)) return nullptr;
+        source.spans = function_spans(source.lines);
+        return &sources.emplace(file, move(source)).first->second;
+    };
+
+    // The file a +++ path names: as written for --no-prefix, otherwise with
+    // leading directories dropped until it exists, whatever the prefix was
+    auto resolve = [&](const string& path) {
+        error_code ec;
+        for (size_t start = 0; start < path.size();) {
+            string candidate = path.substr(start);
+            if ((!toplevel.empty() && filesystem::is_regular_file(toplevel + "/" + candidate, ec)) ||
+                filesystem::is_regular_file(candidate, ec)) return candidate;
+            size_t slash = path.find('/', start);
+            if (slash == string::npos) break;
+            start = slash + 1;
+        }
+        return string();
+    };
+
+    // Functions overlapping a hunk
+    set<string> changed_names;
+    for (const auto& [path, ranges] : parse_unified_diff(diff)) {
+        if (!extensions.count(filesystem::path(path).extension().string())) continue;
+        string file = resolve(path);
+        ScopedSource* source = file.empty() ? nullptr : load(file);
+        if (!source) {
+            cerr << "Cannot find " << path << " from the diff\n";
+            continue;
+        }
+        for (size_t k = 0; k < source->spans.size(); ++k) {
+            const FunctionSpan& span = source->spans[k];
+            for (const auto& range : ranges) {
+                if (range.first <= span.last_line && range.second >= span.first_line) {
+                    source->roles[k] = "changed";
+                    changed_names.insert(span.name);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Lines that mention a changed function, from git grep or the changed files
+    vector<pair<string, int>> mentions;
+    string grep_output, command = "git -C " + shell_quote(toplevel) + " grep --full-name -n -w -I";
+    for (const auto& name : changed_names) command += " -e " + name;
+    command += " -- '*.cpp' '*.cc' '*.cxx' '*.c' '*.h' '*.hpp' '*.hh' '*.hxx' '*.inl' 2>" NULL_DEVICE;
+    if (!changed_names.empty() && !toplevel.empty() && run_command(command, grep_output)) {
+        istringstream in(grep_output);
+        string hit;
+        while (getline(in, hit)) {
+            size_t first = hit.find(':'), second = first == string::npos ? first : hit.find(':', first + 1);
+            if (second != string::npos) mentions.push_back({ hit.substr(0, first), atoi(hit.substr(first + 1, second - first - 1).c_str()) });
+        }
+    }
+    else {
+        for (const auto& [file, source] : sources) {
+            for (size_t i = 0; i < source.lines.size(); ++i) {
+                for (const auto& name : changed_names) {
+                    if (ComplexityAnalyzer::is_recursive(source.lines[i], name)) mentions.push_back({ file, static_cast<int>(i + 1) });
+                }
+            }
+        }
+    }
+    for (const auto& [file, line] : mentions) {
+        ScopedSource* source = load(file);
+        if (!source) continue;
+        for (size_t k = 0; k < source->spans.size(); ++k) {
+            const FunctionSpan& span = source->spans[k];
+            if (line < span.first_line || line > span.last_line) continue;
+            bool calls_changed = any_of(changed_names.begin(), changed_names.end(), [&](const string& name) {
+                return name != span.name && ComplexityAnalyzer::is_recursive(source->lines[line - 1], name);
+            });
+            if (calls_changed && !source->roles.count(k)) source->roles[k] = "caller";
+        }
+    }
+
+    cout << BOLD << CYAN << "Diff-Scoped Analysis" << RESET << " (" << changed_names.size() << " changed functions)\n";
+    cout << BOLD << "================================" << RESET << "\n";
+    for (auto& [file, source] : sources) {
+        if (source.roles.empty()) continue;
+
+        // Selected functions plus the same-file functions they call
+        vector<bool> keep(source.spans.size(), false);
+        for (const auto& [k, role] : source.roles) keep[k] = true;
+        add_callees(source.lines, source.spans, keep);
+        vector<string> masked(source.lines.size());
+        for (size_t k = 0; k < source.spans.size(); ++k) {
+            if (!keep[k]) continue;
+            for (int line = source.spans[k].first_line; line <= source.spans[k].last_line; ++line) {
+                masked[line - 1] = source.lines[line - 1];
+            }
+        }
+
+        ComplexityAnalyzer analyzer(masked, options);
+        auto results = analyzer.analyze();
+        const auto& functions = analyzer.get_functions();
+        for (const auto& [k, role] : source.roles) {
+            const FunctionSpan& span = source.spans[k];
+            auto fn = find_if(functions.begin(), functions.end(), [&](const FunctionInfo& f) { return f.first_line == span.first_line; });
+            if (fn == functions.end()) continue;
+            const FunctionSummary& summary = analyzer.get_summaries()[fn - functions.begin()];
+            cout << BOLD << setw(8) << left << role << right << RESET
+                << (fn->cost_known ? ComplexityAnalyzer::cost_to_string(fn->cost) : ComplexityAnalyzer::complexity_to_string(Complexity::UNKNOWN))
+                << " " << file << ":" << fn->first_line << "-" << fn->last_line << " in " << BOLD << fn->qualified_name << RESET << "\n";
+            for (const auto& step : summary.worst_path) {
+                if (step.function != summary.function) continue;
+                cout << "        " << BOLD << GREEN << "->" << RESET << " line " << results[step.result_index].line_number << ": "
+                    << ComplexityAnalyzer::strip_colors(results[step.result_index].reason) << "\n";
+            }
+        }
+    }
+    return 0;
+}
+
+// A parsed JSON value, as much of JSON as the language server reads
+struct JsonValue {
+    enum class Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Kind kind = Kind::NUL;
+    bool boolean = false;
+    double number = 0;
+    string text;
+    vector<JsonValue> items;
+    vector<pair<string, JsonValue>> fields;
+
+    // Member of an object, or a null value when it is missing
+    const JsonValue& operator[](const string& key) const {
+        static const JsonValue missing;
+        for (const auto& field : fields) {
+            if (field.first == key) return field.second;
+        }
+        return missing;
+    }
+};
+
+static void append_utf8(string& out, uint32_t code) {
+    if (code < 0x80) out += static_cast<char>(code);
+    else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | code >> 6);
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | code >> 12);
+        out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | code >> 18);
+        out += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+static bool read_hex4(string_view in, size_t& pos, uint32_t& code) {
+    if (pos + 4 > in.size()) return false;
+    code = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = in[pos++];
+        code <<= 4;
+        if (c >= '0' && c <= '9') code |= c - '0';
+        else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+// Unescape the JSON string starting at pos into out, leaving pos past it
+static bool read_json_string(string_view in, size_t& pos, string& out) {
+    if (pos >= in.size() || in[pos] != '"') return false;
+    pos++;
+    while (pos < in.size() && in[pos] != '"') {
+        char c = in[pos++];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= in.size()) return false;
+        char escape = in[pos++];
+        switch (escape) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+            uint32_t code;
+            if (!read_hex4(in, pos, code)) return false;
+            uint32_t low;
+            if (code >= 0xD800 && code < 0xDC00 && in.substr(pos, 2) == "\\u" && (pos += 2, read_hex4(in, pos, low))) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            append_utf8(out, code);
+            break;
+        }
+        default: out += escape; break;
+        }
+    }
+    if (pos >= in.size()) return false;
+    pos++;
+    return true;
+}
+
+// Recursive-descent JSON parser; returns false on malformed input
+class JsonParser {
+    string_view in;
+    size_t pos = 0;
+
+    void skip_space() {
+        while (pos < in.size() && isspace(static_cast<unsigned char>(in[pos]))) pos++;
+    }
+
+    bool literal(string_view word) {
+        if (in.substr(pos, word.size()) != word) return false;
+        pos += word.size();
+        return true;
+    }
+
+    bool parse_string(string& out) {
+        return read_json_string(in, pos, out);
+    }
+
+    bool parse_value(JsonValue& value, int depth) {
+        skip_space();
+        if (pos >= in.size() || depth > 64) return false;
+        char c = in[pos];
+        if (c == '{' || c == '[') {
+            bool object = c == '{';
+            value.kind = object ? JsonValue::Kind::OBJECT : JsonValue::Kind::ARRAY;
+            pos++;
+            skip_space();
+            if (pos < in.size() && in[pos] == (object ? '}' : ']')) {
+                pos++;
+                return true;
+            }
+            for (;;) {
+                skip_space();
+                if (object) {
+                    value.fields.emplace_back();
+                    skip_space();
+                    if (!parse_string(value.fields.back().first)) return false;
+                    skip_space();
+                    if (pos >= in.size() || in[pos++] != ':') return false;
+                    if (!parse_value(value.fields.back().second, depth + 1)) return false;
+                }
+                else {
+                    value.items.emplace_back();
+                    if (!parse_value(value.items.back(), depth + 1)) return false;
+                }
+                skip_space();
+                if (pos < in.size() && in[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                return pos < in.size() && in[pos++] == (object ? '}' : ']');
+            }
+        }
+        if (c == '"') {
+            value.kind = JsonValue::Kind::STRING;
+            return parse_string(value.text);
+        }
+        if (literal("true")) {
+            value.kind = JsonValue::Kind::BOOLEAN;
+            value.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            value.kind = JsonValue::Kind::BOOLEAN;
+            return true;
+        }
+        if (literal("null")) return true;
+        size_t start = pos;
+        while (pos < in.size() && (isdigit(static_cast<unsigned char>(in[pos])) || strchr("+-.eE", in[pos]))) pos++;
+        if (start == pos) return false;
+        value.kind = JsonValue::Kind::NUMBER;
+        istringstream number(string(in.substr(start, pos - start)));
+        number.imbue(locale::classic());
+        return static_cast<bool>(number >> value.number);
+    }
+
+public:
+    explicit JsonParser(string_view text) : in(text) {}
+
+    bool parse(JsonValue& value) {
+        if (!parse_value(value, 0)) return false;
+        skip_space();
+        return pos == in.size();
+    }
+};
+
+// Split a compile command into arguments the way a POSIX shell would for
+// the quoting build systems emit
+static vector<string> split_command(const string& command) {
+    vector<string> args;
+    string current;
+    bool in_arg = false;
+    char quote = 0;
+    for (size_t i = 0; i < command.size(); ++i) {
+        char c = command[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+            else if (c == '\\' && quote == '"' && i + 1 < command.size()) current += command[++i];
+            else current += c;
+        }
+        else if (c == '\'' || c == '"') {
+            quote = c;
+            in_arg = true;
+        }
+        else if (c == '\\' && i + 1 < command.size()) {
+            current += command[++i];
+            in_arg = true;
+        }
+        else if (isspace(static_cast<unsigned char>(c))) {
+            if (in_arg) args.push_back(move(current));
+            current.clear();
+            in_arg = false;
+        }
+        else {
+            current += c;
+            in_arg = true;
+        }
+    }
+    if (in_arg) args.push_back(move(current));
+    return args;
+}
+
+// Project include directories of a compile command: -I and -iquote, joined
+// or separate. -isystem directories hold third-party and system headers,
+// which are not followed.
+static vector<filesystem::path> include_directories(const vector<string>& args, const filesystem::path& directory) {
+    vector<filesystem::path> dirs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        for (string flag : { "-I", "-iquote", "/I" }) {
+            if (args[i].compare(0, flag.size(), flag) != 0) continue;
+            string dir = args[i].size() > flag.size() ? args[i].substr(flag.size()) : i + 1 < args.size() ? args[++i] : "";
+            if (!dir.empty()) dirs.push_back((directory / dir).lexically_normal());
+            break;
+        }
+    }
+    return dirs;
+}
+
+// Flags of a compile command that change what the preprocessor produces,
+// with paths made absolute so they hold from any directory
+static vector<string> preprocessor_flags(const vector<string>& args, const filesystem::path& directory) {
+    vector<string> flags;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const string& arg = args[i];
+        if (arg.compare(0, 5, "-std=") == 0) flags.push_back(arg);
+        for (string flag : { "-D", "-U", "-I", "-iquote", "-isystem", "-include" }) {
+            if (arg.compare(0, flag.size(), flag) != 0) continue;
+            string value = arg.size() > flag.size() ? arg.substr(flag.size()) : i + 1 < args.size() ? args[++i] : "";
+            if (value.empty()) break;
+            if (flag == "-D" || flag == "-U") flags.push_back(flag + value);
+            else {
+                flags.push_back(flag);
+                flags.push_back((directory / value).lexically_normal().string());
+            }
+            break;
+        }
+    }
+    return flags;
+}
+
+static uint64_t content_hash(const vector<string>& lines) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& line : lines) {
+        for (char c : line) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        hash = (hash ^ '\n') * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Identity of a set of reachable functions: their names and the analyses
+// that define them, in name order
+static uint64_t functions_hash(const unordered_map<string, const FunctionInfo*>& functions) {
+    vector<pair<string, const FunctionInfo*>> sorted(functions.begin(), functions.end());
+    sort(sorted.begin(), sorted.end());
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& [name, fn] : sorted) {
+        for (char c : name) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        hash = (hash ^ reinterpret_cast<uintptr_t>(fn)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Include directives of a file, read once however many files reach it
+const IncludeGraph::Directives& IncludeGraph::directives_of(const filesystem::path& source) {
+    static const regex include_line(R"(^\s*#\s*include\s*([<"])([^>"]+)[>"])");
+
+    auto inserted = directives.emplace(source.string(), Directives());
+    if (inserted.second) {
+        ifstream in(source, ios::binary);
+        string line;
+        smatch m;
+        while (getline(in, line)) {
+            if (line.find("include") != string::npos && regex_search(line, m, include_line)) {
+                inserted.first->second.emplace_back(m[2].str(), m[1].str() == "\"");
+            }
+        }
+    }
+    return inserted.first->second;
+}
+
+// Headers source includes that exist: quoted names next to source first,
+// then in dirs. Names found nowhere are system or third-party headers.
+vector<size_t> IncludeGraph::includes_of(const filesystem::path& source, const shared_ptr<const Build>& build) {
+    vector<size_t> includes;
+    Directives found = directives_of(source);
+    for (const auto& directive : found) {
+        vector<filesystem::path> candidates;
+        if (directive.second) candidates.push_back(source.parent_path() / directive.first);
+        for (const auto& dir : build->dirs) candidates.push_back(dir / directive.first);
+        for (auto& candidate : candidates) {
+            error_code ec;
+            candidate = candidate.lexically_normal();
+            if (!filesystem::is_regular_file(candidate, ec)) continue;
+            includes.push_back(add_header(candidate, build));
+            break;
+        }
+    }
+    return includes;
+}
+
+size_t IncludeGraph::add_header(const filesystem::path& path, const shared_ptr<const Build>& build) {
+    auto inserted = header_index.emplace(display(path), headers.size());
+    if (!inserted.second) return inserted.first->second;
+    size_t index = headers.size();
+    headers.push_back({ path, inserted.first->first, build, {}, 0, nullptr });
+    vector<size_t> includes = includes_of(path, build);
+    headers[index].includes = move(includes);
+    return index;
+}
+
+void IncludeGraph::add_unit(const filesystem::path& source, const shared_ptr<const Build>& build) {
+    string name = display(source);
+    if (!unit_builds.emplace(name, build).second) return;
+    vector<size_t> includes = includes_of(source, build);
+    units.push_back({ name, build, move(includes) });
+}
+
+// Longest include chain below a header; an include that closes a cycle
+// does not count
+int IncludeGraph::level_of(size_t header, vector<char>& state) {
+    if (state[header] == 1) return -1;
+    if (state[header] == 2) return headers[header].level;
+    state[header] = 1;
+    int level = 0;
+    for (size_t include : headers[header].includes) level = max(level, level_of(include, state) + 1);
+    state[header] = 2;
+    return headers[header].level = level;
+}
+
+// Functions of the analyzed headers reachable through includes, from
+// headers below the given level; the first header to define a name wins,
+// as the first declaration would
+IncludeGraph::HeaderFunctions IncludeGraph::reachable_functions(const vector<size_t>& includes, int below) const {
+    HeaderFunctions functions;
+    vector<bool> seen(headers.size());
+    vector<size_t> pending(includes.rbegin(), includes.rend());
+    while (!pending.empty()) {
+        size_t h = pending.back();
+        pending.pop_back();
+        if (seen[h] || headers[h].level >= below) continue;
+        seen[h] = true;
+        if (headers[h].analysis) {
+            for (const auto& fn : headers[h].analysis->analyzer.get_functions()) functions.emplace(fn.name, &fn);
+        }
+        pending.insert(pending.end(), headers[h].includes.rbegin(), headers[h].includes.rend());
+    }
+    return functions;
+}
+
+// Analyze headers level by level, each level in parallel, so the headers a
+// header includes are done before it; then hand units their functions
+void IncludeGraph::analyze(const AnalyzerOptions& options) {
+    vector<char> state(headers.size());
+    vector<vector<size_t>> levels;
+    for (size_t h = 0; h < headers.size(); ++h) {
+        size_t level = static_cast<size_t>(level_of(h, state));
+        if (levels.size() <= level) levels.resize(level + 1);
+        levels[level].push_back(h);
+    }
+    for (const auto& level : levels) {
+        run_parallel(level.size(), worker_count(level.size()), [&](size_t, size_t i) {
+            Header& header = headers[level[i]];
+            vector<string> lines;
+            if (!load_source(header.path.string(), lines, &header.build->flags)) return;
+            // Calls resolve against the functions the header reaches, which
+            // differ between copies included through different directories
+            HeaderFunctions functions = reachable_functions(header.includes, header.level);
+            uint64_t hash = content_hash(lines) ^ functions_hash(functions) * 1099511628211ull;
+            header.analysis = results.find(hash);
+            if (header.analysis) return;
+            AnalyzerOptions header_options = options;
+            header_options.headers = &functions;
+            header.analysis = results.insert(hash, make_shared<const AnalyzedSource>(lines, header_options, filesystem::file_time_type(), 0));
+        });
+    }
+
+    // A unit that another file includes is analyzed once, as a header
+    units.erase(remove_if(units.begin(), units.end(), [&](const Unit& unit) { return header_index.count(unit.name); }), units.end());
+    for (const auto& unit : units) unit_functions[unit.name] = reachable_functions(unit.includes, numeric_limits<int>::max());
+}
+
+// Every source under paths. Without build flags to go by, includes are
+// looked up in the given directories, then in every directory holding a
+// header, as if each had been passed with -I.
+void IncludeGraph::load_paths(const vector<string>& paths, const AnalyzerOptions& options) {
+    static const unordered_set<string> header_extensions = { ".h", ".hpp", ".hh", ".hxx", ".inl" };
+
+    error_code ec;
+    cwd = filesystem::current_path(ec);
+    vector<filesystem::path> files;
+    auto build = make_shared<Build>();
+    auto add_dir = [&](const filesystem::path& dir) {
+        if (find(build->dirs.begin(), build->dirs.end(), dir) != build->dirs.end()) return;
+        build->dirs.push_back(dir);
+        build->flags.push_back("-I");
+        build->flags.push_back(dir.string());
+    };
+    for (const auto& path : paths) {
+        filesystem::path root = filesystem::absolute(path, ec).lexically_normal();
+        add_dir(filesystem::is_directory(root, ec) ? root : root.parent_path());
+    }
+    for (const auto& file : collect_sources(paths)) {
+        files.push_back(filesystem::absolute(file, ec).lexically_normal());
+        if (header_extensions.count(files.back().extension().string())) add_dir(files.back().parent_path());
+    }
+    for (const auto& file : files) add_unit(file, build);
+    analyze(options);
+}
+
+// The units a compile database lists, once each. A build that compiles a
+// unit twice, say for two targets, takes the include directories of its
+// first entry.
+bool IncludeGraph::load_compile_commands(const string& path, const AnalyzerOptions& options, string& error) {
+    filesystem::path file = path;
+    error_code ec;
+    if (filesystem::is_directory(file, ec)) file /= "compile_commands.json";
+    ifstream in(file, ios::binary);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    JsonValue entries;
+    if (!in || !JsonParser(text).parse(entries) || entries.kind != JsonValue::Kind::ARRAY) {
+        error = "Cannot read compile database " + file.string();
+        return false;
+    }
+
+    cwd = filesystem::current_path(ec);
+    filesystem::path base = filesystem::absolute(file, ec).parent_path();
+    for (const auto& entry : entries.items) {
+        if (entry["file"].kind != JsonValue::Kind::STRING) continue;
+        filesystem::path directory = base / entry["directory"].text;
+        vector<string> args;
+        if (entry["arguments"].kind == JsonValue::Kind::ARRAY) {
+            for (const auto& arg : entry["arguments"].items) args.push_back(arg.text);
+        }
+        else args = split_command(entry["command"].text);
+        auto build = make_shared<Build>();
+        build->dirs = include_directories(args, directory);
+        build->flags = preprocessor_flags(args, directory);
+        add_unit((directory / entry["file"].text).lexically_normal(), build);
+    }
+    if (units.empty()) {
+        error = "No translation units in " + file.string();
+        return false;
+    }
+    analyze(options);
+    return true;
+}
+
+// Append text to out as a quoted JSON string
+static void append_json_string(string& out, string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            }
+            else out += c;
+        }
+    }
+    out += '"';
+}
+
+static string json_string(const string& text) {
+    string out;
+    append_json_string(out, text);
+    return out;
+}
+
+// A request id echoed back in its reply, either a number or a string
+static string json_id(const JsonValue& id) {
+    if (id.kind == JsonValue::Kind::STRING) return json_string(id.text);
+    if (id.kind == JsonValue::Kind::NUMBER) return to_string(static_cast<long long>(id.number));
+    return "null";
+}
+
+// LSP positions count UTF-16 code units; lines are kept as UTF-8
+static size_t utf16_to_byte(const string& line, size_t units) {
+    size_t pos = 0;
+    while (pos < line.size() && units > 0) {
+        unsigned char c = line[pos];
+        size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        units -= min<size_t>(units, length == 4 ? 2 : 1);
+        pos = min(line.size(), pos + length);
+    }
+    return pos;
+}
+
+static size_t byte_to_utf16(const string& line, size_t bytes) {
+    size_t units = 0;
+    for (size_t pos = 0; pos < min(bytes, line.size()); ++pos) {
+        unsigned char c = line[pos];
+        if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+    }
+    return units;
+}
+
+// One diagnostic, positioned relative to the first line of its function so
+// it stays valid while edits elsewhere move the function
+struct LineHint {
+    int offset;        // lines below the function's first line
+    size_t first_byte;
+    size_t last_byte;  // exclusive
+    int severity;      // 2 warning, 3 information, 4 hint
+    string message;
+};
+
+// Diagnostics of one function, with the names its body calls and the
+// summary its callers are analyzed against while it is unchanged
+struct FunctionHints {
+    string name;
+    vector<LineHint> hints;
+    vector<string> calls;
+    FunctionInfo summary;
+    bool summarized = false;
+};
+
+// An open document: its text and spans, and the diagnostics of each span
+// by id. Spans are also indexed by name and by the names they call, so an
+// edit finds its callers and callees without reading the other functions.
+struct LspDocument {
+    IncrementalDocument text;
+    unordered_map<size_t, FunctionHints> functions;
+    unordered_map<string, vector<size_t>> by_name;
+    unordered_map<string, vector<size_t>> callers_of;
+};
+
+// Apply one textDocument/didChange content change: a range replaced by
+// text, or the whole document when there is no range
+static void apply_change(IncrementalDocument& text, const JsonValue& change) {
+    const JsonValue& range = change["range"];
+    if (range.kind != JsonValue::Kind::OBJECT) {
+        text.replace(0, text.size(), change["text"].text);
+        return;
+    }
+    const vector<string>& lines = text.lines();
+    auto offset = [&](const JsonValue& position) {
+        size_t line = min(static_cast<size_t>(position["line"].number), lines.size() - 1);
+        return text.offset_of(line, utf16_to_byte(lines[line], static_cast<size_t>(position["character"].number)));
+    };
+    size_t first = offset(range["start"]), last = max(first, offset(range["end"]));
+    text.replace(first, last - first, change["text"].text);
+}
+
+// Names a function body shows followed by '(', each once
+static vector<string> called_names(const vector<string>& lines, const FunctionSpan& span) {
+    auto word = [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    vector<string> names;
+    for (int line = span.first_line; line <= span.last_line; ++line) {
+        const string& text = lines[line - 1];
+        for (size_t i = 0; i < text.size();) {
+            if (!word(text[i])) {
+                ++i;
+                continue;
+            }
+            size_t end = i;
+            while (end < text.size() && word(text[end])) end++;
+            size_t next = text.find_first_not_of(" \t", end);
+            if (next != string::npos && text[next] == '(') names.push_back(text.substr(i, end - i));
+            i = end;
+        }
+    }
+    sort(names.begin(), names.end());
+    names.erase(unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+static void erase_id(vector<size_t>& ids, size_t id) {
+    ids.erase(remove(ids.begin(), ids.end(), id), ids.end());
+}
+
+// What callers of a function depend on: its cost, space and parameters
+static string summary_key(const FunctionInfo& fn) {
+    string key = fn.cost_known ? fn.cost.to_string() : "?";
+    key += '\n' + fn.peak_space.to_string();
+    for (const auto& param : fn.params) key += '\n' + param;
+    return key;
+}
+
+// Re-analyze the functions the last edits rebuilt, and then, round by
+// round, the callers of every function whose summary came out different;
+// an edit that leaves a function's cost alone stops there. Each analysis
+// sees only the functions it re-analyzes, together with the callees in a
+// cycle with them so recursion is solved; every other function stands in
+// with its last summary. A keystroke costs the functions it touches rather
+// than the whole file.
+static void update_document(LspDocument& doc, const AnalyzerOptions& options) {
+    const vector<string>& lines = doc.text.lines();
+    const vector<FunctionSpan>& spans = doc.text.spans();
+    auto [added, dropped] = doc.text.take_edits();
+    unordered_map<size_t, size_t> position;
+    for (size_t k = 0; k < spans.size(); ++k) position[spans[k].id] = k;
+
+    // An edited function is compared with its summary from before the edit;
+    // callers of a function that is gone now call something unresolved
+    unordered_map<string, vector<FunctionHints>> old_by_name;
+    for (size_t id : dropped) {
+        auto it = doc.functions.find(id);
+        if (it == doc.functions.end()) continue;
+        erase_id(doc.by_name[it->second.name], id);
+        for (const auto& callee : it->second.calls) erase_id(doc.callers_of[callee], id);
+        if (it->second.summarized) old_by_name[it->second.name].push_back(move(it->second));
+        doc.functions.erase(it);
+    }
+    vector<size_t> pending;
+    unordered_set<size_t> queued;
+    for (size_t id : added) {
+        auto at = position.find(id);
+        if (at == position.end()) continue;
+        const FunctionSpan& span = spans[at->second];
+        FunctionHints& hints = doc.functions[id];
+        hints.name = span.name;
+        hints.calls = called_names(lines, span);
+        for (const auto& callee : hints.calls) doc.callers_of[callee].push_back(id);
+        doc.by_name[span.name].push_back(id);
+        auto old = old_by_name.find(span.name);
+        if (old != old_by_name.end() && !old->second.empty()) {
+            hints.summary = move(old->second.back().summary);
+            hints.summarized = true;
+            old->second.pop_back();
+        }
+        pending.push_back(id);
+        queued.insert(id);
+    }
+    for (const auto& [name, left] : old_by_name) {
+        if (left.empty()) continue;
+        for (size_t caller : doc.callers_of[name]) {
+            if (queued.insert(caller).second) pending.push_back(caller);
+        }
+    }
+
+    auto callees_of = [&](size_t id, auto&& visit) {
+        for (const auto& name : doc.functions[id].calls) {
+            auto it = doc.by_name.find(name);
+            if (it == doc.by_name.end()) continue;
+            for (size_t callee : it->second) {
+                if (callee != id) visit(callee);
+            }
+        }
+    };
+    auto callers_of = [&](size_t id, auto&& visit) {
+        auto it = doc.callers_of.find(doc.functions[id].name);
+        if (it == doc.callers_of.end()) return;
+        for (size_t caller : it->second) {
+            if (caller != id) visit(caller);
+        }
+    };
+    auto reach = [&](auto&& edges) {
+        unordered_set<size_t> seen(pending.begin(), pending.end());
+        vector<size_t> work = pending;
+        while (!work.empty()) {
+            size_t id = work.back();
+            work.pop_back();
+            edges(id, [&](size_t next) {
+                if (seen.insert(next).second) work.push_back(next);
+            });
+        }
+        return seen;
+    };
+
+    while (!pending.empty()) {
+        // The pending functions and those both called by and calling them
+        unordered_set<size_t> called = reach(callees_of), calling = reach(callers_of);
+        vector<size_t> keep;
+        for (size_t id : called) {
+            if (calling.count(id)) keep.push_back(position[id]);
+        }
+        sort(keep.begin(), keep.end());
+        unordered_set<size_t> kept;
+        for (size_t k : keep) kept.insert(spans[k].id);
+
+        unordered_map<string, const FunctionInfo*> summaries;
+        for (const auto& span : spans) {
+            const FunctionHints& other = doc.functions[span.id];
+            if (!kept.count(span.id) && other.summarized) summaries.emplace(other.name, &other.summary);
+        }
+        vector<string> compact;
+        vector<size_t> origin;  // span of each compact line
+        for (size_t k : keep) {
+            doc.functions[spans[k].id].hints.clear();
+            for (int line = spans[k].first_line; line <= spans[k].last_line; ++line) {
+                compact.push_back(lines[line - 1]);
+                if (!compact.back().empty() && compact.back().back() == '\r') compact.back().pop_back();
+                origin.push_back(k);
+            }
+        }
+
+        AnalyzerOptions compact_options = options;
+        compact_options.headers = &summaries;
+        ComplexityAnalyzer analyzer(compact, compact_options);
+        auto results = analyzer.analyze();
+        // Compact line n is line n - first_compact[k] of span k
+        unordered_map<size_t, int> first_compact;
+        for (size_t i = origin.size(); i-- > 0;) first_compact[origin[i]] = static_cast<int>(i + 1);
+        auto add_hint = [&](int compact_line, size_t first_byte, size_t last_byte, int severity, const string& message) {
+            size_t k = origin[compact_line - 1];
+            doc.functions[spans[k].id].hints.push_back({ compact_line - first_compact[k], first_byte, last_byte, severity, message });
+        };
+        auto whole_line = [&](int compact_line) {
+            const string& text = compact[compact_line - 1];
+            size_t indent = text.find_first_not_of(" \t");
+            return make_pair(indent == string::npos ? 0 : indent, text.size());
+        };
+        for (const auto& fn : analyzer.get_functions()) {
+            auto [first, last] = whole_line(fn.first_line);
+            add_hint(fn.first_line, first, last, 3, fn.name + ": " + ComplexityAnalyzer::strip_colors(fn.cost_known
+                ? ComplexityAnalyzer::cost_to_string(fn.cost) : ComplexityAnalyzer::complexity_to_string(Complexity::UNKNOWN)));
+        }
+        for (const auto& result : results) {
+            if (result.cost.is_constant()) continue;
+            auto [first, last] = whole_line(result.line_number);
+            add_hint(result.line_number, first, last, 4, ComplexityAnalyzer::strip_colors(
+                ComplexityAnalyzer::cost_to_string(result.cost) + ": " + result.reason));
+        }
+        for (const auto& finding : analyzer.get_findings()) {
+            add_hint(finding.line_number, static_cast<size_t>(finding.first_column - 1), static_cast<size_t>(finding.last_column), 2,
+                finding.message + " Suggestion: " + finding.suggestion);
+        }
+
+        // Callers of the functions whose summary changed go next
+        vector<size_t> next;
+        queued.clear();
+        for (const auto& fn : analyzer.get_functions()) {
+            size_t k = origin[fn.first_line - 1];
+            if (first_compact[k] != fn.first_line) continue;
+            size_t id = spans[k].id;
+            FunctionHints& hints = doc.functions[id];
+            bool changed = !hints.summarized || summary_key(hints.summary) != summary_key(fn);
+            hints.summary = fn;
+            hints.summary.calls.clear();
+            hints.summarized = true;
+            if (!changed) continue;
+            callers_of(id, [&](size_t caller) {
+                if (!kept.count(caller) && queued.insert(caller).second) next.push_back(caller);
+            });
+        }
+        pending = move(next);
+    }
+}
+
+static void write_lsp_message(const string& body) {
+    cout << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    cout.flush();
+}
+
+static void publish_diagnostics(const string& uri, const LspDocument& doc) {
+    ostringstream out;
+    out.imbue(locale::classic());
+    out << R"({"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":)" << json_string(uri) << R"(,"diagnostics":[)";
+    bool first = true;
+    for (const auto& span : doc.text.spans()) {
+        auto it = doc.functions.find(span.id);
+        if (it == doc.functions.end()) continue;
+        for (const auto& hint : it->second.hints) {
+            size_t line = static_cast<size_t>(span.first_line - 1 + hint.offset);
+            const string& text = doc.text.lines()[line];
+            out << (first ? "" : ",") << R"({"range":{"start":{"line":)" << line << R"(,"character":)" << byte_to_utf16(text, hint.first_byte)
+                << R"(},"end":{"line":)" << line << R"(,"character":)" << byte_to_utf16(text, hint.last_byte)
+                << R"(}},"severity":)" << hint.severity << R"(,"source":"time","message":)" << json_string(hint.message) << "}";
+            first = false;
+        }
+    }
+    out << "]}}";
+    write_lsp_message(out.str());
+}
+
+static bool read_lsp_message(istream& in, string& body) {
+    size_t length = 0;
+    bool have_length = false;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) {
+            if (have_length) break;
+            continue;
+        }
+        if (line.compare(0, 15, "Content-Length:") == 0) {
+            length = strtoul(line.c_str() + 15, nullptr, 10);
+            have_length = true;
+        }
+    }
+    if (!have_length) return false;
+    body.assign(length, '\0');
+    return length == 0 || static_cast<bool>(in.read(&body[0], static_cast<streamsize>(length)));
+}
+
+// Language server over stdio. Documents are synced incrementally and each
+// change republishes per-line costs, function costs and findings as
+// diagnostics.
+static int run_language_server(const AnalyzerOptions& options) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    unordered_map<string, LspDocument> documents;
+    bool shutting_down = false;
+    string body;
+    while (read_lsp_message(cin, body)) {
+        JsonValue message;
+        if (!JsonParser(body).parse(message)) continue;
+        const string& method = message["method"].text;
+        const JsonValue& params = message["params"];
+        const JsonValue& id = message["id"];
+        bool request = id.kind != JsonValue::Kind::NUL;
+
+        if (method == "initialize") {
+            write_lsp_message(R"({"jsonrpc":"2.0","id":)" + json_id(id) +
+                R"(,"result":{"capabilities":{"textDocumentSync":{"openClose":true,"change":2}},"serverInfo":{"name":"time"}}})");
+        }
+        else if (method == "shutdown") {
+            shutting_down = true;
+            write_lsp_message(R"({"jsonrpc":"2.0","id":)" + json_id(id) + R"(,"result":null})");
+        }
+        else if (method == "exit") {
+            return shutting_down ? 0 : 1;
+        }
+        else if (method == "textDocument/didOpen") {
+            const string& uri = params["textDocument"]["uri"].text;
+            LspDocument& doc = documents[uri];
+            doc = LspDocument();
+            doc.text = IncrementalDocument(params["textDocument"]["text"].text);
+            update_document(doc, options);
+            publish_diagnostics(uri, doc);
+        }
+        else if (method == "textDocument/didChange") {
+            const string& uri = params["textDocument"]["uri"].text;
+            auto it = documents.find(uri);
+            if (it == documents.end()) continue;
+            for (const auto& change : params["contentChanges"].items) apply_change(it->second.text, change);
+            update_document(it->second, options);
+            publish_diagnostics(uri, it->second);
+        }
+        else if (method == "textDocument/didClose") {
+            const string& uri = params["textDocument"]["uri"].text;
+            documents.erase(uri);
+            write_lsp_message(R"({"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":)" + json_string(uri) +
+                R"(,"diagnostics":[]}})");
+        }
+        else if (request) {
+            write_lsp_message(R"({"jsonrpc":"2.0","id":)" + json_id(id) +
+                R"(,"error":{"code":-32601,"message":"Method not found"}})");
+        }
+    }
+    return shutting_down ? 0 : 1;
+}
+
+// Reads JSON without building values: walks an object member by member
+// and hands out keys and values as views of the input. Only strings that
+// are asked for are unescaped, into a buffer the caller reuses.
+class JsonCursor {
+    string_view in;
+    size_t pos = 0;
+
+    void skip_space() {
+        while (pos < in.size() && isspace(static_cast<unsigned char>(in[pos]))) pos++;
+    }
+
+    // Position just past the string starting at pos, or npos
+    size_t string_end(size_t at) const {
+        for (size_t i = at + 1; i < in.size(); ++i) {
+            if (in[i] == '\\') i++;
+            else if (in[i] == '"') return i + 1;
+        }
+        return string_view::npos;
+    }
+
+public:
+    explicit JsonCursor(string_view text) : in(text) {}
+
+    bool enter_object() {
+        skip_space();
+        if (pos >= in.size() || in[pos] != '{') return false;
+        pos++;
+        return true;
+    }
+
+    // Next member of the object entered last; false at its end or on error
+    bool next_member(string_view& key) {
+        skip_space();
+        if (pos < in.size() && in[pos] == ',') {
+            pos++;
+            skip_space();
+        }
+        if (pos >= in.size() || in[pos] != '"') {
+            if (pos < in.size() && in[pos] == '}') pos++;
+            return false;
+        }
+        size_t end = string_end(pos);
+        if (end == string_view::npos) return false;
+        key = in.substr(pos + 1, end - pos - 2);
+        pos = end;
+        skip_space();
+        if (pos >= in.size() || in[pos] != ':') return false;
+        pos++;
+        skip_space();
+        return true;
+    }
+
+    // Skip the value at the cursor; raw receives its text
+    bool skip_value(string_view& raw) {
+        size_t start = pos;
+        if (pos >= in.size()) return false;
+        if (in[pos] == '"') {
+            pos = string_end(pos);
+            if (pos == string_view::npos) return false;
+        }
+        else if (in[pos] == '{' || in[pos] == '[') {
+            int depth = 0;
+            for (; pos < in.size(); ++pos) {
+                if (in[pos] == '"') {
+                    pos = string_end(pos);
+                    if (pos == string_view::npos) return false;
+                    pos--;
+                }
+                else if (in[pos] == '{' || in[pos] == '[') depth++;
+                else if ((in[pos] == '}' || in[pos] == ']') && --depth == 0) break;
+            }
+            if (pos >= in.size()) return false;
+            pos++;
+        }
+        else {
+            while (pos < in.size() && !strchr(",}] \t\r\n", in[pos])) pos++;
+        }
+        raw = in.substr(start, pos - start);
+        return pos > start;
+    }
+
+    // Unescape the string value at the cursor into out
+    bool read_string(string& out) {
+        out.clear();
+        return read_json_string(in, pos, out);
+    }
+};
+
+// Streaming JSON serializer. Values are appended to a buffer as they come;
+// the only state is whether each open container still needs a comma. With a
+// sink, the buffer is written out whenever it grows past 64 KiB, so output
+// of any size is produced without holding it.
+class JsonWriter {
+    string& out;
+    ostream* sink;
+    vector<bool> needs_comma;
+    bool after_key = false;
+
+    void separator() {
+        if (after_key) after_key = false;
+        else if (!needs_comma.empty()) {
+            if (needs_comma.back()) out += ',';
+            needs_comma.back() = true;
+        }
+    }
+
+    JsonWriter& open(char bracket) {
+        separator();
+        out += bracket;
+        needs_comma.push_back(false);
+        return *this;
+    }
+
+    JsonWriter& close(char bracket) {
+        out += bracket;
+        needs_comma.pop_back();
+        if (sink && out.size() >= (1 << 16)) flush();
+        return *this;
+    }
+
+public:
+    explicit JsonWriter(string& buffer, ostream* stream = nullptr) : out(buffer), sink(stream) {}
+
+    JsonWriter& begin_object() { return open('{'); }
+    JsonWriter& end_object() { return close('}'); }
+    JsonWriter& begin_array() { return open('['); }
+    JsonWriter& end_array() { return close(']'); }
+
+    JsonWriter& key(string_view name) {
+        separator();
+        append_json_string(out, name);
+        out += ':';
+        after_key = true;
+        return *this;
+    }
+
+    JsonWriter& value(string_view text) {
+        separator();
+        append_json_string(out, text);
+        return *this;
+    }
+
+    JsonWriter& value(long long number) {
+        separator();
+        char digits[24];
+        out.append(digits, to_chars(digits, digits + sizeof(digits), number).ptr);
+        return *this;
+    }
+
+    // Already serialized JSON, such as a request id echoed back
+    JsonWriter& raw(string_view json) {
+        separator();
+        out += json;
+        return *this;
+    }
+
+    void flush() {
+        if (!sink) return;
+        sink->write(out.data(), static_cast<streamsize>(out.size()));
+        out.clear();
+    }
+};
+
+// Members describing one analysis, written into the open object: overall
+// cost and space, then functions, lines with a non-constant cost and findings
+static void write_analysis(JsonWriter& json, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>& results) {
+    json.key("complexity").value(analyzer.overall().to_string());
+    json.key("space").value(analyzer.overall_space_peak().to_string());
+    json.key("functions").begin_array();
+    for (const auto& fn : analyzer.get_functions()) {
+        json.begin_object();
+        json.key("name").value(fn.qualified_name);
+        json.key("first_line").value(fn.first_line);
+        json.key("last_line").value(fn.last_line);
+        json.key("cost").value(fn.cost_known ? fn.cost.to_string() : "unknown");
+        json.key("space").value(fn.peak_space.to_string());
+        json.end_object();
+    }
+    json.end_array();
+    json.key("lines").begin_array();
+    for (const auto& result : results) {
+        if (result.cost.is_constant()) continue;
+        json.begin_object();
+        json.key("line").value(result.line_number);
+        json.key("cost").value(result.cost.to_string());
+        json.key("reason").value(ComplexityAnalyzer::strip_colors(result.reason));
+        json.end_object();
+    }
+    json.end_array();
+    json.key("findings").begin_array();
+    for (const auto& finding : analyzer.get_findings()) {
+        json.begin_object();
+        json.key("line").value(finding.line_number);
+        json.key("first_column").value(finding.first_column);
+        json.key("last_column").value(finding.last_column);
+        json.key("rule").value(finding.rule);
+        json.key("message").value(finding.message);
+        json.key("suggestion").value(finding.suggestion);
+        json.end_object();
+    }
+    json.end_array();
+}
+
+// Answer one NDJSON request line into out. buffers are the worker's own
+// and keep their capacity from request to request.
+static void answer_request(string_view request, const AnalyzerOptions& defaults, string& source, vector<string>& lines, string& out) {
+    string_view id = "null", key, raw;
+    AnalyzerOptions options = defaults;
+    bool have_source = false;
+    JsonCursor cursor(request);
+    bool valid = cursor.enter_object();
+    while (valid && cursor.next_member(key)) {
+        if (key == "source") valid = have_source = cursor.read_string(source);
+        else if (key == "options") {
+            valid = cursor.enter_object();
+            while (valid && cursor.next_member(key)) {
+                valid = cursor.skip_value(raw);
+                if (key == "worst_case") options.worst_case = raw == "true";
+            }
+        }
+        else {
+            valid = cursor.skip_value(raw);
+            if (key == "id") id = raw;
+        }
+    }
+    out.clear();
+    JsonWriter json(out);
+    if (!valid || !have_source) {
+        json.begin_object().key("id").raw(id).key("error").value("malformed request").end_object();
+        return;
+    }
+
+    size_t count = 0;
+    for (size_t start = 0;; ++count) {
+        size_t end = source.find('\n', start);
+        if (count == lines.size()) lines.emplace_back();
+        lines[count].assign(source, start, end == string::npos ? string::npos : end - start);
+        if (!lines[count].empty() && lines[count].back() == '\r') lines[count].pop_back();
+        if (end == string::npos) break;
+        start = end + 1;
+    }
+    lines.resize(count + 1);
+    try {
+        ComplexityAnalyzer analyzer(lines, options);
+        auto results = analyzer.analyze();
+        json.begin_object().key("id").raw(id);
+        write_analysis(json, analyzer, results);
+        json.end_object();
+    }
+    catch (const exception& e) {
+        out.clear();
+        JsonWriter error(out);
+        error.begin_object().key("id").raw(id).key("error").value(e.what()).end_object();
+    }
+}
+
+// Batch mode: one JSON request per input line, {"id", "source", "options"},
+// and one JSON result per output line with the same id. Requests run on a
+// pool of workers and results are written as they finish, so they may come
+// out of order. Input lines are read into a fixed set of slots, which bounds
+// the work in flight: the reader waits for a free slot.
+static int run_batch(const AnalyzerOptions& defaults) {
+    size_t workers = max<size_t>(1, thread::hardware_concurrency());
+    vector<string> slots(workers * 2);
+    vector<size_t> free_slots, ready;
+    for (size_t i = 0; i < slots.size(); ++i) free_slots.push_back(i);
+    size_t ready_head = 0;
+    bool done = false;
+    mutex lock, output;
+    condition_variable slot_freed, work_ready;
+    // Workers write results under their own lock; a flush from cin's tie on
+    // the reader thread would race with them
+    ostream* tied = cin.tie(nullptr);
+
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; ++w) {
+        pool.emplace_back([&] {
+            string source, out;
+            vector<string> lines;
+            for (;;) {
+                size_t slot;
+                {
+                    unique_lock<mutex> guard(lock);
+                    work_ready.wait(guard, [&] { return ready_head < ready.size() || done; });
+                    if (ready_head == ready.size()) return;
+                    slot = ready[ready_head++];
+                    if (ready_head == ready.size()) {
+                        ready.clear();
+                        ready_head = 0;
+                    }
+                }
+                answer_request(slots[slot], defaults, source, lines, out);
+                {
+                    lock_guard<mutex> guard(output);
+                    out += '\n';
+                    cout.write(out.data(), static_cast<streamsize>(out.size()));
+                    cout.flush();
+                }
+                {
+                    lock_guard<mutex> guard(lock);
+                    free_slots.push_back(slot);
+                }
+                slot_freed.notify_one();
+            }
+        });
+    }
+
+    for (;;) {
+        size_t slot;
+        {
+            unique_lock<mutex> guard(lock);
+            slot_freed.wait(guard, [&] { return !free_slots.empty(); });
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        if (!getline(cin, slots[slot])) break;
+        if (slots[slot].find_first_not_of(" \t\r") == string::npos) {
+            lock_guard<mutex> guard(lock);
+            free_slots.push_back(slot);
+            continue;
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            ready.push_back(slot);
+        }
+        work_ready.notify_one();
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        done = true;
+    }
+    work_ready.notify_all();
+    for (auto& worker : pool) worker.join();
+    cin.tie(tied);
+    return 0;
+}
+
+// Output formats for full results. Text is the colored report.
+enum class OutputFormat { TEXT, JSON, SARIF, BINARY };
+
+static bool parse_output_format(const string& name, OutputFormat& format) {
+    static const pair<const char*, OutputFormat> names[] = {
+        { "text", OutputFormat::TEXT }, { "json", OutputFormat::JSON }, { "sarif", OutputFormat::SARIF }, { "binary", OutputFormat::BINARY } };
+    for (const auto& [text, value] : names) {
+        if (name == text) {
+            format = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// SARIF rule ids: the findings plus a note for each super-linear function
+static const pair<const char*, const char*> sarif_rules[] = {
+    { "complexity", "Function with a super-constant time complexity" },
+    { "hidden-quadratic", "Linear-time operation inside a loop" },
+    { "loop-allocation", "Allocation repeated on every loop iteration" },
+    { "strided-access", "Array traversed against its memory layout" },
+    { "unreadable-file", "Source file that could not be read" },
+};
+
+static void write_sarif_location(JsonWriter& json, const string& file, int line, int first_column, int last_column) {
+    json.begin_array().begin_object().key("physicalLocation").begin_object();
+    json.key("artifactLocation").begin_object().key("uri").value(file).end_object();
+    json.key("region").begin_object().key("startLine").value(line);
+    if (first_column > 0) json.key("startColumn").value(first_column).key("endColumn").value(last_column);
+    json.end_object().end_object().end_object().end_array();
+}
+
+// SARIF results of one file. Columns are converted to UTF-16 code units,
+// SARIF's default column kind.
+static void write_sarif_results(JsonWriter& json, const string& file, const ComplexityAnalyzer& analyzer) {
+    const vector<string>& lines = analyzer.get_lines();
+    for (const auto& fn : analyzer.get_functions()) {
+        if (fn.cost_known && fn.cost.is_constant()) continue;
+        json.begin_object().key("ruleId").value("complexity").key("level").value("note");
+        json.key("message").begin_object().key("text")
+            .value(fn.qualified_name + " is " + (fn.cost_known ? fn.cost.to_string() : "of unknown complexity")).end_object();
+        json.key("locations");
+        write_sarif_location(json, file, fn.first_line, 0, 0);
+        json.end_object();
+    }
+    for (const auto& finding : analyzer.get_findings()) {
+        const string& line = lines[finding.line_number - 1];
+        json.begin_object().key("ruleId").value(finding.rule).key("level").value("warning");
+        json.key("message").begin_object().key("text").value(finding.message + " " + finding.suggestion).end_object();
+        json.key("locations");
+        write_sarif_location(json, file, finding.line_number,
+            static_cast<int>(byte_to_utf16(line, static_cast<size_t>(finding.first_column - 1)) + 1),
+            static_cast<int>(byte_to_utf16(line, static_cast<size_t>(finding.last_column)) + 1));
+        json.end_object();
+    }
+}
+
+// LEB128: seven bits per byte, low bits first, high bit set on all but the last
+static void append_varint(string& out, uint64_t value) {
+    for (; value >= 0x80; value >>= 7) out += static_cast<char>((value & 0x7F) | 0x80);
+    out += static_cast<char>(value);
+}
+
+// Compact binary results. A stream starts with the magic "TCB1" and holds
+// records, each a tag byte followed by LEB128 varints and string references.
+// A string reference is the index of an earlier string plus one, or 0
+// followed by the length and bytes of a new string, which takes the next
+// index. Each file record starts a fresh string table, so files are encoded
+// independently. Line numbers are zigzag-encoded deltas from the line of the
+// previous record in the file; complexities are Complexity codes.
+//   1 FILE        path
+//   2 FUNCTION    name, first line, line count, complexity, cost, space
+//   3 LINE        line, complexity, cost, reason
+//   4 FINDING     line, first column, last column, rule, message, suggestion
+//   5 SUMMARY     cost, space
+//   6 UNREADABLE  message, in place of the records of a file that could not be read
+enum class BinaryRecord : unsigned char { FILE = 1, FUNCTION = 2, LINE = 3, FINDING = 4, SUMMARY = 5, UNREADABLE = 6 };
+
+class BinaryWriter {
+    string& out;
+    unordered_map<string, uint32_t> strings;
+    int previous_line = 0;
+
+public:
+    explicit BinaryWriter(string& buffer) : out(buffer) {}
+
+    BinaryWriter& record(BinaryRecord tag) {
+        if (tag == BinaryRecord::FILE) {
+            strings.clear();
+            previous_line = 0;
+        }
+        out += static_cast<char>(tag);
+        return *this;
+    }
+
+    BinaryWriter& varint(uint64_t value) {
+        append_varint(out, value);
+        return *this;
+    }
+
+    BinaryWriter& line(int number) {
+        int64_t delta = static_cast<int64_t>(number) - previous_line;
+        previous_line = number;
+        return varint(static_cast<uint64_t>(delta) << 1 ^ static_cast<uint64_t>(delta >> 63));
+    }
+
+    BinaryWriter& code(Complexity complexity) { return varint(static_cast<uint64_t>(complexity)); }
+
+    BinaryWriter& text(const string& value) {
+        auto [it, added] = strings.emplace(value, static_cast<uint32_t>(strings.size()));
+        if (!added) return varint(it->second + 1ull);
+        varint(0).varint(value.size());
+        out += value;
+        return *this;
+    }
+};
+
+static void write_binary_results(BinaryWriter& binary, const string& file, const ComplexityAnalyzer& analyzer,
+    const vector<CodeAnalysis>& results) {
+    binary.record(BinaryRecord::FILE).text(file);
+    for (const auto& fn : analyzer.get_functions()) {
+        binary.record(BinaryRecord::FUNCTION).text(fn.qualified_name).line(fn.first_line).varint(static_cast<uint64_t>(fn.last_line - fn.first_line + 1))
+            .code(fn.cost_known ? fn.cost.classify() : Complexity::UNKNOWN).text(fn.cost_known ? fn.cost.to_string() : "unknown")
+            .text(fn.peak_space.to_string());
+    }
+    for (const auto& result : results) {
+        if (result.cost.is_constant()) continue;
+        binary.record(BinaryRecord::LINE).line(result.line_number).code(result.cost.classify()).text(result.cost.to_string())
+            .text(ComplexityAnalyzer::strip_colors(result.reason));
+    }
+    for (const auto& finding : analyzer.get_findings()) {
+        binary.record(BinaryRecord::FINDING).line(finding.line_number).varint(static_cast<uint64_t>(finding.first_column))
+            .varint(static_cast<uint64_t>(finding.last_column)).text(finding.rule).text(finding.message).text(finding.suggestion);
+    }
+    binary.record(BinaryRecord::SUMMARY).text(analyzer.overall().to_string()).text(analyzer.overall_space_peak().to_string());
+}
+
+// The part of a formatted report that belongs to one file
+static void write_file_results(OutputFormat format, const string& file, const ComplexityAnalyzer& analyzer,
+    const vector<CodeAnalysis>& results, string& out) {
+    JsonWriter json(out);
+    if (format == OutputFormat::JSON) {
+        json.begin_object().key("file").value(file);
+        write_analysis(json, analyzer, results);
+        json.end_object();
+    }
+    else if (format == OutputFormat::SARIF) {
+        json.begin_array();
+        write_sarif_results(json, file, analyzer);
+        json.end_array();
+        // Only the elements go into the shared results array
+        out = out.size() > 2 ? out.substr(1, out.size() - 2) : string();
+    }
+    else {
+        BinaryWriter binary(out);
+        write_binary_results(binary, file, analyzer, results);
+    }
+}
+
+// The part of a formatted report for a file that could not be analyzed
+static void write_file_error(OutputFormat format, const string& file, const string& message, string& out) {
+    JsonWriter json(out);
+    if (format == OutputFormat::JSON) {
+        json.begin_object().key("file").value(file).key("error").value(message).end_object();
+    }
+    else if (format == OutputFormat::SARIF) {
+        json.begin_object().key("ruleId").value("unreadable-file").key("level").value("error");
+        json.key("message").begin_object().key("text").value(file + ": " + message).end_object();
+        json.key("locations");
+        write_sarif_location(json, file, 1, 0, 0);
+        json.end_object();
+    }
+    else {
+        BinaryWriter binary(out);
+        binary.record(BinaryRecord::FILE).text(file);
+        binary.record(BinaryRecord::UNREADABLE).text(message);
+    }
+}
+
+// Writes the per-file parts of a formatted report between its header and
+// footer, in file order, as soon as each is complete
+class FormattedReport {
+    OutputFormat format;
+    ostream& sink;
+    bool first = true;
+
+public:
+    FormattedReport(OutputFormat output, ostream& stream) : format(output), sink(stream) {
+#ifdef _WIN32
+        if (format == OutputFormat::BINARY) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        string header;
+        if (format == OutputFormat::JSON) header = R"({"files":[)";
+        else if (format == OutputFormat::SARIF) {
+            JsonWriter json(header);
+            json.begin_object().key("$schema").value("https://json.schemastore.org/sarif-2.1.0.json").key("version").value("2.1.0");
+            json.key("runs").begin_array().begin_object().key("tool").begin_object().key("driver").begin_object();
+            json.key("name").value("time").key("rules").begin_array();
+            for (const auto& [id, description] : sarif_rules) {
+                json.begin_object().key("id").value(id).key("shortDescription").begin_object().key("text").value(description).end_object().end_object();
+            }
+            header += R"(]}},"results":[)";
+        }
+        else header = "TCB1";
+        sink.write(header.data(), static_cast<streamsize>(header.size()));
+    }
+
+    void add(const string& part) {
+        if (part.empty()) return;
+        if (format != OutputFormat::BINARY && !first) sink << ',';
+        first = false;
+        sink.write(part.data(), static_cast<streamsize>(part.size()));
+    }
+
+    void finish() {
+        if (format == OutputFormat::JSON) sink << "]}\n";
+        else if (format == OutputFormat::SARIF) sink << "]}]}\n";
+        sink.flush();
+    }
+};
+
+// Analyze every source under paths and write the full results in a
+// machine-readable format. Files are analyzed in parallel; each file's part
+// is serialized on its worker and written once the files before it are out,
+// so only out-of-order parts are ever held.
+static int run_formatted_report(const vector<string>& paths, OutputFormat format, const AnalyzerOptions& options) {
+    vector<string> files = collect_sources(paths);
+    FormattedReport report(format, cout);
+    vector<string> parts(files.size());
+    vector<bool> done(files.size(), false);
+    size_t next = 0;
+    mutex lock;
+    auto drain = [&] {
+        for (; next < files.size() && done[next]; ++next) {
+            report.add(parts[next]);
+            string().swap(parts[next]);
+        }
+    };
+    auto complete = [&](size_t f, string part) {
+        lock_guard<mutex> guard(lock);
+        parts[f] = move(part);
+        done[f] = true;
+        drain();
+    };
+    size_t unreadable = analyze_sources(files, worker_count(files.size()), options,
+        [&](size_t, size_t f, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>& results) {
+            string part;
+            write_file_results(format, filesystem::path(files[f]).lexically_normal().generic_string(), analyzer, results, part);
+            complete(f, move(part));
+        },
+        [&](size_t f) {
+            string part;
+            write_file_error(format, filesystem::path(files[f]).lexically_normal().generic_string(), "could not be read", part);
+            complete(f, move(part));
+        });
+    report.finish();
+    if (unreadable > 0) cerr << "Skipped " << unreadable << " unreadable files\n";
+    return 0;
+}
+
+// A whole file mapped read-only into memory
+class MappedFile {
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return;
+        bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (bytes) length = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (view != MAP_FAILED) {
+                bytes = static_cast<const char*>(view);
+                length = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (bytes) munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Results index. The file is the in-memory layout itself, so opening it is
+// a mapping and a few bounds checks. All sections are 8-byte aligned and
+// all offsets are from the start of the file; strings are offsets into a
+// pool of NUL-terminated, interned strings. Integers are in the writer's
+// byte order, which byte_order records.
+//   files     sorted by path; each owns a contiguous run of entries
+//   entries   functions and outermost loop nests with a growing cost,
+//             ordered by file, then line
+//   names     entry indices sorted by name
+//   postings  per Complexity class, ascending entry indices of that class
+static const char index_magic[8] = { 'T', 'C', 'I', 'D', 'X', '1', 0, 0 };
+static const size_t complexity_classes = static_cast<size_t>(Complexity::UNKNOWN) + 1;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t byte_order;  // 0x01020304 as written
+    uint32_t file_count;
+    uint32_t entry_count;
+    uint32_t string_pool_size;
+    uint64_t file_table;
+    uint64_t entry_table;
+    uint64_t name_table;
+    uint64_t posting_table;  // complexity_classes IndexPostings
+    uint64_t string_pool;
+};
+
+struct IndexFile {
+    uint32_t path;
+    uint32_t first_entry;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct IndexEntry {
+    uint32_t file;
+    uint32_t name;
+    uint32_t first_line;
+    uint32_t last_line;
+    uint32_t cost;
+    uint32_t reason;
+    float degree;
+    uint8_t complexity;
+    uint8_t loop;
+    uint8_t exponential;  // 0 polynomial, 1 exponential, 2 factorial
+    uint8_t log_degree;
+};
+
+struct IndexPostings {
+    uint64_t offset;  // of count uint32_t entry indices
+    uint64_t count;
+};
+
+static_assert(sizeof(IndexHeader) == 64 && sizeof(IndexFile) == 16 && sizeof(IndexEntry) == 32 && sizeof(IndexPostings) == 16,
+    "index records are written as they are laid out in memory");
+
+// Names accepted by --class, in Complexity order
+static const char* const complexity_names[complexity_classes] = {
+    "constant", "linear", "quadratic", "cubic", "linearithmic", "logarithmic", "exponential", "unknown" };
+
+// A --class argument, in any case
+static bool parse_complexity_name(const string& text, Complexity& complexity) {
+    for (size_t c = 0; c < complexity_classes; ++c) {
+        const char* name = complexity_names[c];
+        if (text.size() == strlen(name) && equal(text.begin(), text.end(), name,
+            [](char a, char b) { return tolower(static_cast<unsigned char>(a)) == b; })) {
+            complexity = static_cast<Complexity>(c);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Analyze paths and write their index. Every table is built in memory
+// first, since the sections refer to each other by offset.
+static bool write_index(const string& path, const vector<string>& paths, const AnalyzerOptions& options) {
+    vector<string> files = collect_sources(paths);
+    vector<vector<Hotspot>> per_file(files.size());
+    analyze_sources(files, worker_count(files.size()), options,
+        [&](size_t, size_t f, const ComplexityAnalyzer& analyzer, const vector<CodeAnalysis>& results) {
+            for_each_hotspot(files[f], analyzer, results, [&](Hotspot hotspot) { per_file[f].push_back(move(hotspot)); });
+            sort(per_file[f].begin(), per_file[f].end(), [](const Hotspot& a, const Hotspot& b) {
+                return tie(a.first_line, a.loop, a.last_line) < tie(b.first_line, b.loop, b.last_line);
+            });
+        });
+
+    string pool;
+    unordered_map<string, uint32_t> interned;
+    auto intern = [&](const string& text) {
+        auto [it, added] = interned.emplace(text, static_cast<uint32_t>(pool.size()));
+        if (added) pool.append(text).push_back('\0');
+        return it->second;
+    };
+
+    vector<string> keys(files.size());
+    vector<size_t> order(files.size());
+    for (size_t f = 0; f < files.size(); ++f) {
+        keys[f] = filesystem::path(files[f]).lexically_normal().generic_string();
+        order[f] = f;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    vector<IndexFile> file_table;
+    vector<IndexEntry> entries;
+    vector<vector<uint32_t>> postings(complexity_classes);
+    for (size_t f : order) {
+        file_table.push_back({ intern(keys[f]), static_cast<uint32_t>(entries.size()), static_cast<uint32_t>(per_file[f].size()), 0 });
+        for (const auto& hotspot : per_file[f]) {
+            auto [exponential, degree, log_degree] = hotspot.cost.growth();
+            Complexity complexity = hotspot.cost.classify();
+            postings[static_cast<size_t>(complexity)].push_back(static_cast<uint32_t>(entries.size()));
+            entries.push_back({ static_cast<uint32_t>(file_table.size() - 1), intern(hotspot.function),
+                static_cast<uint32_t>(hotspot.first_line), static_cast<uint32_t>(hotspot.last_line), intern(hotspot.cost.to_string()),
+                intern(hotspot.reason), static_cast<float>(degree), static_cast<uint8_t>(complexity), hotspot.loop,
+                static_cast<uint8_t>(exponential), static_cast<uint8_t>(min(log_degree, 255)) });
+        }
+    }
+    vector<uint32_t> names(entries.size());
+    for (size_t i = 0; i < names.size(); ++i) names[i] = static_cast<uint32_t>(i);
+    stable_sort(names.begin(), names.end(), [&](uint32_t a, uint32_t b) {
+        return strcmp(pool.c_str() + entries[a].name, pool.c_str() + entries[b].name) < 0;
+    });
+
+    auto aligned = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+    IndexHeader header = {};
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.byte_order = 0x01020304;
+    header.file_count = static_cast<uint32_t>(file_table.size());
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.string_pool_size = static_cast<uint32_t>(pool.size());
+    header.file_table = sizeof(IndexHeader);
+    header.entry_table = aligned(header.file_table + file_table.size() * sizeof(IndexFile));
+    header.name_table = aligned(header.entry_table + entries.size() * sizeof(IndexEntry));
+    header.posting_table = aligned(header.name_table + names.size() * sizeof(uint32_t));
+    vector<IndexPostings> posting_table(complexity_classes);
+    uint64_t offset = header.posting_table + complexity_classes * sizeof(IndexPostings);
+    for (size_t c = 0; c < complexity_classes; ++c) {
+        posting_table[c] = { offset, postings[c].size() };
+        offset = aligned(offset + postings[c].size() * sizeof(uint32_t));
+    }
+    header.string_pool = aligned(offset);
+
+    ofstream out(path, ios::binary);
+    auto write_at = [&](uint64_t at, const void* data, size_t size) {
+        static const char padding[8] = {};
+        out.write(padding, static_cast<streamsize>(at - static_cast<uint64_t>(out.tellp())));
+        out.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+    };
+    write_at(0, &header, sizeof(header));
+    write_at(header.file_table, file_table.data(), file_table.size() * sizeof(IndexFile));
+    write_at(header.entry_table, entries.data(), entries.size() * sizeof(IndexEntry));
+    write_at(header.name_table, names.data(), names.size() * sizeof(uint32_t));
+    write_at(header.posting_table, posting_table.data(), posting_table.size() * sizeof(IndexPostings));
+    for (size_t c = 0; c < complexity_classes; ++c) {
+        write_at(posting_table[c].offset, postings[c].data(), postings[c].size() * sizeof(uint32_t));
+    }
+    write_at(header.string_pool, pool.data(), pool.size());
+    return static_cast<bool>(out);
+}
+
+// Filters of an index query; empty ones match everything
+struct IndexQuery {
+    vector<Complexity> classes;
+    string under;  // directory or file
+    string name;   // exact function name
+    int loop = -1; // 0 functions only, 1 loop nests only
+};
+
+// A mapped index, checked once on open and then read in place
+class ResultsIndex {
+    MappedFile file;
+    const IndexHeader* header = nullptr;
+
+    template <class T>
+    const T* table(uint64_t offset) const { return reinterpret_cast<const T*>(file.data() + offset); }
+
+    bool fits(uint64_t offset, uint64_t size) const { return offset % 8 == 0 && offset <= file.size() && size <= file.size() - offset; }
+
+public:
+    explicit ResultsIndex(const string& path) : file(path) {
+        if (file.size() < sizeof(IndexHeader)) return;
+        const IndexHeader* h = table<IndexHeader>(0);
+        if (memcmp(h->magic, index_magic, sizeof(index_magic)) != 0 || h->byte_order != 0x01020304) return;
+        if (!fits(h->file_table, uint64_t(h->file_count) * sizeof(IndexFile)) ||
+            !fits(h->entry_table, uint64_t(h->entry_count) * sizeof(IndexEntry)) ||
+            !fits(h->name_table, uint64_t(h->entry_count) * sizeof(uint32_t)) ||
+            !fits(h->posting_table, complexity_classes * sizeof(IndexPostings)) ||
+            !fits(h->string_pool, h->string_pool_size) || h->string_pool_size == 0 ||
+            file.data()[h->string_pool + h->string_pool_size - 1] != '\0') return;
+        for (size_t c = 0; c < complexity_classes; ++c) {
+            const IndexPostings& p = table<IndexPostings>(h->posting_table)[c];
+            if (p.count > h->entry_count || !fits(p.offset, p.count * sizeof(uint32_t))) return;
+        }
+        header = h;
+    }
+
+    // Opening checks only that the tables lie inside the file. The offsets
+    // and indexes inside them are checked as queries reach them, so a
+    // corrupt entry is skipped rather than read out of bounds.
+    bool valid() const { return header != nullptr; }
+    uint32_t file_count() const { return header->file_count; }
+    uint32_t entry_count() const { return header->entry_count; }
+    const char* text(uint32_t offset) const {
+        return offset < header->string_pool_size ? file.data() + header->string_pool + offset : "";
+    }
+
+    const IndexFile& file_at(uint32_t f) const { return table<IndexFile>(header->file_table)[f]; }
+
+    // Entries [first, last) of a file, cut to the entry table
+    pair<uint32_t, uint32_t> entries_of(const IndexFile& f) const {
+        uint32_t first = min(f.first_entry, entry_count());
+        return { first, first + min(f.entry_count, entry_count() - first) };
+    }
+
+    // Entry e, or nullptr when it points outside the index
+    const IndexEntry* entry(uint32_t e) const {
+        if (e >= entry_count()) return nullptr;
+        const IndexEntry* found = table<IndexEntry>(header->entry_table) + e;
+        return found->file < file_count() && found->complexity < complexity_classes ? found : nullptr;
+    }
+
+    // Entry index ranges [first, last) of the files under a directory, or of
+    // the file itself, by binary search over the sorted file table
+    vector<pair<uint32_t, uint32_t>> entry_ranges(const string& under) const {
+        vector<pair<uint32_t, uint32_t>> ranges;
+        const IndexFile* begin = table<IndexFile>(header->file_table);
+        const IndexFile* end = begin + file_count();
+        auto path_less = [&](const IndexFile& f, const string& key) { return strcmp(text(f.path), key.c_str()) < 0; };
+        if (under.empty()) {
+            ranges.push_back({ 0, entry_count() });
+            return ranges;
+        }
+        const IndexFile* exact = lower_bound(begin, end, under, path_less);
+        if (exact != end && under == text(exact->path)) ranges.push_back(entries_of(*exact));
+        string directory = under.back() == '/' ? under : under + "/";
+        const IndexFile* first = lower_bound(begin, end, directory, path_less);
+        const IndexFile* last = first;
+        while (last != end && strncmp(text(last->path), directory.c_str(), directory.size()) == 0) ++last;
+        if (first != last) ranges.push_back({ entries_of(*first).first, max(entries_of(*first).first, entries_of(*(last - 1)).second) });
+        return ranges;
+    }
+
+    // Indices of the matching entries in index order. Class filters walk
+    // only the posting lists, from a binary search to the start of each
+    // range; a name filter walks only the matching run of the name table.
+    vector<uint32_t> query(const IndexQuery& q) const {
+        vector<uint32_t> matches;
+        auto keep = [&](uint32_t e) {
+            const IndexEntry* found = entry(e);
+            return found && (q.loop < 0 || found->loop == q.loop) && (q.name.empty() || q.name == text(found->name));
+        };
+        auto name_of = [&](uint32_t e) {
+            const IndexEntry* found = entry(e);
+            return found ? text(found->name) : "";
+        };
+        for (const auto& [first, last] : entry_ranges(q.under)) {
+            if (!q.name.empty()) {
+                const uint32_t* names = table<uint32_t>(header->name_table);
+                const uint32_t* e = lower_bound(names, names + entry_count(), q.name, [&](uint32_t index, const string& name) {
+                    return strcmp(name_of(index), name.c_str()) < 0;
+                });
+                for (; e != names + entry_count() && q.name == name_of(*e); ++e) {
+                    if (*e < first || *e >= last || !keep(*e)) continue;
+                    if (q.classes.empty() || find(q.classes.begin(), q.classes.end(),
+                        static_cast<Complexity>(entry(*e)->complexity)) != q.classes.end()) matches.push_back(*e);
+                }
+            }
+            else if (!q.classes.empty()) {
+                for (Complexity c : q.classes) {
+                    const IndexPostings& p = table<IndexPostings>(header->posting_table)[static_cast<size_t>(c)];
+                    const uint32_t* list = table<uint32_t>(p.offset);
+                    for (const uint32_t* e = lower_bound(list, list + p.count, first); e != list + p.count && *e < last; ++e) {
+                        if (keep(*e)) matches.push_back(*e);
+                    }
+                }
+            }
+            else {
+                for (uint32_t e = first; e < last; ++e) {
+                    if (keep(e)) matches.push_back(e);
+                }
+            }
+        }
+        sort(matches.begin(), matches.end());
+        matches.erase(unique(matches.begin(), matches.end()), matches.end());
+        return matches;
+    }
+};
+
+static int run_index_query(const string& path, const IndexQuery& q) {
+    auto start = chrono::steady_clock::now();
+    ResultsIndex index(path);
+    if (!index.valid()) {
+        cerr << "Cannot open index " << path << "\n";
+        return 2;
+    }
+    vector<uint32_t> matches = index.query(q);
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    for (uint32_t e : matches) {
+        const IndexEntry& entry = *index.entry(e);
+        cout << index.text(entry.cost) << " " << index.text(index.file_at(entry.file).path) << ":" << entry.first_line << "-"
+            << entry.last_line << " " << (entry.loop ? "loop in " : "function ") << index.text(entry.name) << "\n";
+    }
+    cerr << matches.size() << " of " << index.entry_count() << " entries in " << format_number(elapsed) << " ms\n";
+    return 0;
+}
+
+static bool read_varint(string_view in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+// One function's state in a history run
+struct HistoryValue {
+    Complexity complexity;
+    string cost;
+
+    bool operator==(const HistoryValue& other) const { return complexity == other.complexity && cost == other.cost; }
+};
+
+// Functions by key (file, a tab, qualified name) at some run
+using HistoryState = map<string, HistoryValue>;
+
+// A change in one run; a removed function has no value
+struct HistoryChange {
+    string key;
+    bool removed;
+    HistoryValue value;
+};
+
+// History store: the magic "TCHS1\n", then one block per run, appended and
+// never rewritten. A block is 'R', the varint length of its payload and the
+// payload: the commit id (varint length and bytes), the varint number of
+// changes, then each change against the state the earlier blocks add up to.
+// Changes are sorted by key and each key is front-coded against the one
+// before it (varint shared prefix length, varint suffix length, suffix).
+// The key is followed by a byte, 0 for a removed function or 1 plus its
+// Complexity code, and for a present function its cost as a string. A run
+// that changes nothing costs a few bytes; a block cut short by a crash is
+// ignored when read.
+static const string history_magic = "TCHS1\n";
+
+// Replay a store, calling visit(commit, changes) for each complete block,
+// and set complete_end to the offset just past the last of them. Lengths
+// read from the file are checked against what is left of it. Returns false
+// when the file is not a store.
+template <class Visit>
+static bool replay_history(const string& path, Visit visit, uint64_t* complete_end = nullptr) {
+    ifstream in(path, ios::binary);
+    string magic(history_magic.size(), '\0');
+    if (!in.read(&magic[0], static_cast<streamsize>(magic.size())) || magic != history_magic) return false;
+    error_code ec;
+    uint64_t file_size = filesystem::file_size(path, ec);
+    if (complete_end) *complete_end = magic.size();
+    string payload;
+    vector<HistoryChange> changes;
+    char tag;
+    while (in.get(tag) && tag == 'R') {
+        uint64_t size = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            char byte;
+            if (!in.get(byte)) return true;
+            size |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (static_cast<unsigned char>(byte) < 0x80) break;
+        }
+        auto at = in.tellg();
+        if (at < 0 || size > file_size - static_cast<uint64_t>(at)) return true;
+        payload.resize(size);
+        if (!in.read(&payload[0], static_cast<streamsize>(size))) return true;
+
+        size_t pos = 0;
+        uint64_t length, count;
+        if (!read_varint(payload, pos, length) || length > payload.size() - pos) return true;
+        string commit = payload.substr(pos, length);
+        pos += length;
+        // Every change takes at least three bytes
+        if (!read_varint(payload, pos, count) || count > (payload.size() - pos) / 3) return true;
+        changes.resize(count);
+        string key;
+        for (auto& change : changes) {
+            uint64_t shared, suffix;
+            if (!read_varint(payload, pos, shared) || !read_varint(payload, pos, suffix) || shared > key.size() ||
+                suffix > payload.size() - pos) return true;
+            key.resize(shared);
+            key.append(payload, pos, suffix);
+            pos += suffix;
+            if (pos >= payload.size()) return true;
+            unsigned char state = static_cast<unsigned char>(payload[pos++]);
+            change.key = key;
+            change.removed = state == 0;
+            change.value.complexity = change.removed ? Complexity::UNKNOWN : static_cast<Complexity>(state - 1);
+            change.value.cost.clear();
+            if (!change.removed) {
+                if (!read_varint(payload, pos, length) || length > payload.size() - pos) return true;
+                change.value.cost.assign(payload, pos, length);
+                pos += length;
+            }
+        }
+        if (pos != payload.size()) return true;
+        visit(commit, changes);
+        if (complete_end) *complete_end = static_cast<uint64_t>(in.tellg());
+    }
+    return true;
+}
+
+static void apply_history(HistoryState& state, const vector<HistoryChange>& changes) {
+    for (const auto& change : changes) {
+        if (change.removed) state.erase(change.key);
+        else state[change.key] = change.value;
+    }
+}
+
+// Analyze paths and append a run for commit to the store, holding only
+// what changed since the last run
+static bool append_history(const string& path, const string& commit, const vector<string>& paths, const AnalyzerOptions& options) {
+    HistoryState previous;
+    bool exists = filesystem::exists(path);
+    uint64_t complete_end = 0;
+    if (exists && !replay_history(path, [&](const string&, const vector<HistoryChange>& changes) { apply_history(previous, changes); },
+        &complete_end)) {
+        return false;
+    }
+
+    // A run cut short, say by a crash, is dropped so the new one follows
+    // the last complete run rather than being hidden behind the partial one
+    error_code ec;
+    uint64_t size = exists ? filesystem::file_size(path, ec) : 0;
+    if (!ec && size > complete_end) {
+        filesystem::resize_file(path, complete_end, ec);
+        if (ec) return false;
+        cerr << "Dropped " << size - complete_end << " bytes of an incomplete run from " << path << "\n";
+    }
+
+    HistoryState current;
+    for (auto& entry : analyze_baseline(paths, options)) {
+        current[entry.file + '\t' + entry.name] = { entry.complexity, move(entry.cost) };
+    }
+
+    // Both states are sorted, so one merge finds every change in key order
+    vector<HistoryChange> changes;
+    auto before = previous.begin();
+    auto after = current.begin();
+    while (before != previous.end() || after != current.end()) {
+        if (after == current.end() || (before != previous.end() && before->first < after->first)) {
+            changes.push_back({ before->first, true, {} });
+            ++before;
+        }
+        else if (before == previous.end() || after->first < before->first) {
+            changes.push_back({ after->first, false, after->second });
+            ++after;
+        }
+        else {
+            if (!(before->second == after->second)) changes.push_back({ after->first, false, after->second });
+            ++before;
+            ++after;
+        }
+    }
+
+    string payload;
+    append_varint(payload, commit.size());
+    payload += commit;
+    append_varint(payload, changes.size());
+    const string* last = nullptr;
+    for (const auto& change : changes) {
+        size_t shared = 0;
+        if (last) {
+            size_t limit = min(last->size(), change.key.size());
+            while (shared < limit && (*last)[shared] == change.key[shared]) shared++;
+        }
+        append_varint(payload, shared);
+        append_varint(payload, change.key.size() - shared);
+        payload.append(change.key, shared, string::npos);
+        payload += static_cast<char>(change.removed ? 0 : static_cast<int>(change.value.complexity) + 1);
+        if (!change.removed) {
+            append_varint(payload, change.value.cost.size());
+            payload += change.value.cost;
+        }
+        last = &change.key;
+    }
+    string block = "R";
+    append_varint(block, payload.size());
+    block += payload;
+
+    ofstream out(path, ios::binary | ios::app);
+    if (!exists) out << history_magic;
+    out.write(block.data(), static_cast<streamsize>(block.size()));
+    out.flush();
+    if (!out) return false;
+    cout << "Recorded " << commit << ": " << current.size() << " functions, " << changes.size() << " changed\n";
+    return true;
+}
+
+static string history_display(const string& key) {
+    size_t tab = key.find('\t');
+    return tab == string::npos ? key : key.substr(0, tab) + ": " + key.substr(tab + 1);
+}
+
+// Every run where a function named name (a qualified name, or file:name)
+// appeared, changed or disappeared
+static int print_function_history(const string& path, const string& name) {
+    bool found = false;
+    bool valid = replay_history(path, [&](const string& commit, const vector<HistoryChange>& changes) {
+        for (const auto& change : changes) {
+            size_t tab = change.key.find('\t');
+            string function = change.key.substr(tab + 1);
+            if (function != name && change.key.substr(0, tab) + ":" + function != name) continue;
+            found = true;
+            cout << commit << "  " << history_display(change.key) << "  "
+                << (change.removed ? string("removed") : change.value.cost) << "\n";
+        }
+    });
+    if (!valid) {
+        cerr << "Cannot read history " << path << "\n";
+        return 2;
+    }
+    if (!found) cerr << "No history for " << name << "\n";
+    return found ? 0 : 1;
+}
+
+// Functions present at both commits whose complexity class differs
+static int print_class_changes(const string& path, const string& from, const string& to) {
+    HistoryState state, at_from, at_to;
+    bool seen_from = false, seen_to = false;
+    bool valid = replay_history(path, [&](const string& commit, const vector<HistoryChange>& changes) {
+        apply_history(state, changes);
+        if (commit == from) {
+            at_from = state;
+            seen_from = true;
+        }
+        if (commit == to) {
+            at_to = state;
+            seen_to = true;
+        }
+    });
+    if (!valid || !seen_from || !seen_to) {
+        cerr << (valid ? "Commit not recorded: " + (seen_from ? to : from) : "Cannot read history " + path) << "\n";
+        return 2;
+    }
+    size_t changed = 0;
+    for (const auto& [key, before] : at_from) {
+        auto after = at_to.find(key);
+        if (after == at_to.end() || after->second.complexity == before.complexity) continue;
+        changed++;
+        cout << history_display(key) << "  " << before.cost << " -> " << after->second.cost << "\n";
+    }
+    cerr << changed << " functions changed class between " << from << " and " << to << "\n";
+    return 0;
+}
+
+// Run one command line: everything main does once the locale is set up.
+// The daemon runs it per request with the standard streams redirected.
+static int run_cli(const string& program, const vector<string>& args) {
+    AnalyzerOptions options;
+    size_t top = 100;
+    string write_baseline_to, baseline_from, diff_file, git_diff_base;
+    OutputFormat format = OutputFormat::TEXT;
+    string index_to, index_from, history_to, history_from, commit, history_function;
+    string compile_commands;
+    vector<string> changed_between;
+    IndexQuery query;
+    bool git_diff = false, lsp = false, batch = false, use_include_graph = false, preprocess = false;
+    Preprocessor preprocessor_options;
+    vector<string> paths;
+    size_t argc = args.size();
+    for (size_t i = 0; i < argc; ++i) {
+        const string& arg = args[i];
+        if (arg == "--worst-case") {
+            options.worst_case = true;
+        }
+        else if (arg == "--top" && i + 1 < argc && atoi(args[i + 1].c_str()) > 0) {
+            top = static_cast<size_t>(atoi(args[++i].c_str()));
+        }
+        else if (arg == "--write-baseline" && i + 1 < argc) {
+            write_baseline_to = args[++i];
+        }
+        else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_from = args[++i];
+        }
+        else if (arg == "--diff" && i + 1 < argc) {
+            diff_file = args[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc && parse_output_format(args[i + 1], format)) {
+            ++i;
+        }
+        else if (arg == "--write-index" && i + 1 < argc) {
+            index_to = args[++i];
+        }
+        else if (arg == "--query" && i + 1 < argc) {
+            index_from = args[++i];
+        }
+        else if (arg == "--class" && i + 1 < argc) {
+            Complexity complexity;
+            if (!parse_complexity_name(args[++i], complexity)) {
+                cerr << "Unknown complexity class: " << args[i] << " (expected";
+                for (size_t c = 0; c < complexity_classes; ++c) cerr << (c == 0 ? " " : ", ") << complexity_names[c];
+                cerr << ")\n";
+                return 1;
+            }
+            query.classes.push_back(complexity);
+        }
+        else if (arg == "--under" && i + 1 < argc) {
+            query.under = filesystem::path(args[++i]).lexically_normal().generic_string();
+            if (query.under == ".") query.under.clear();
+        }
+        else if (arg == "--name" && i + 1 < argc) {
+            query.name = args[++i];
+        }
+        else if (arg == "--kind" && i + 1 < argc && (args[i + 1] == "function" || args[i + 1] == "loop")) {
+            query.loop = args[++i] == "loop";
+        }
+        else if (arg == "--append-history" && i + 1 < argc) {
+            history_to = args[++i];
+        }
+        else if (arg == "--commit" && i + 1 < argc) {
+            commit = args[++i];
+        }
+        else if (arg == "--history" && i + 1 < argc) {
+            history_from = args[++i];
+        }
+        else if (arg == "--function" && i + 1 < argc) {
+            history_function = args[++i];
+        }
+        else if (arg == "--changed" && i + 2 < argc) {
+            changed_between = { args[i + 1], args[i + 2] };
+            i += 2;
+        }
+        else if (arg == "--compile-commands" && i + 1 < argc) {
+            compile_commands = args[++i];
+        }
+        else if (arg == "--preprocess") {
+            preprocess = true;
+        }
+        else if (arg == "--preprocessor" && i + 1 < argc) {
+            preprocessor_options.command = args[++i];
+        }
+        else if (arg.size() > 2 && arg[0] == '-' && (arg[1] == 'D' || arg[1] == 'U' || arg[1] == 'I')) {
+            preprocessor_options.flags.push_back(arg);
+        }
+        else if (arg == "--include-graph") {
+            use_include_graph = true;
+        }
+        else if (arg == "--lsp") {
+            lsp = true;
+        }
+        else if (arg == "--ndjson") {
+            batch = true;
+        }
+        else if (arg == "--git-diff") {
+            git_diff = true;
+            if (i + 1 < argc && args[i + 1][0] != '-') git_diff_base = args[++i];
+        }
+        else if (arg.compare(0, 2, "--") != 0) {
+            paths.push_back(arg);
+        }
+        else {
+            cerr << "Unknown option: " << arg << "\n";
+            cerr << "Usage: " << program << " [--worst-case] [--top K | --write-baseline FILE | --baseline FILE] [path...]\n";
+            cerr << "       " << program << " [--worst-case] --format text|json|sarif|binary [path...]\n";
+            cerr << "       " << program << " [--worst-case] --diff FILE|- | --git-diff [REV]\n";
+            cerr << "       " << program << " [--worst-case] --write-index FILE [path...]\n";
+            cerr << "       " << program << " [--worst-case] --include-graph [path...] | --compile-commands FILE|DIR [mode options...]\n";
+            cerr << "       " << program << " --preprocess [--preprocessor CMD] [-DNAME[=VALUE]] [-UNAME] [-IDIR] [mode options...]\n";
+            cerr << "       " << program << " [--worst-case] --append-history STORE [--commit ID] [path...]\n";
+            cerr << "       " << program << " --history STORE --function NAME | --changed FROM TO\n";
+            cerr << "       " << program << " --query INDEX [--class C]... [--under DIR] [--name NAME] [--kind function|loop]\n";
+            cerr << "       " << program << " [--worst-case] --lsp | --ndjson\n";
+            cerr << "       " << program << " --serve SOCKET | --connect SOCKET [options...]\n";
+            return 1;
+        }
+    }
+
+    // Preprocessor options mean nothing without --preprocess; running
+    // without the macros and include paths they ask for would be silent
+    if (!preprocess && (!preprocessor_options.flags.empty() || preprocessor_options.command != Preprocessor().command)) {
+        cerr << (preprocessor_options.flags.empty() ? string("--preprocessor") : preprocessor_options.flags.front())
+             << " requires --preprocess\n";
+        return 1;
+    }
+
+    if (lsp) return run_language_server(options);
+    if (batch) return run_batch(options);
+
+    // Diff-scoped mode: only the functions a change touches, and their callers
+    if (git_diff || !diff_file.empty()) {
+        string diff;
+        if (git_diff) {
+            if (git_diff_base.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_./~^@{}-") != string::npos ||
+                !run_command("git diff -U0 " + git_diff_base + " 2>" NULL_DEVICE, diff)) {
+                cerr << "git diff failed\n";
+                return 2;
+            }
+        }
+        else if (diff_file == "-") {
+            diff.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        }
+        else {
+            ifstream in(diff_file, ios::binary);
+            if (!in) {
+                cerr << "Cannot read diff " << diff_file << "\n";
+                return 2;
+            }
+            diff.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        return run_diff_scoped(diff, options);
+    }
+
+    // Preprocessing: every source below is analyzed as the preprocessor
+    // expands it with the given flags
+    struct PreprocessorScope {
+        ~PreprocessorScope() { preprocessor = nullptr; }
+    } preprocessor_scope;
+    if (preprocess) preprocessor = &preprocessor_options;
+
+    // Include graph: the sources under paths, or the units of a compile
+    // database, with the headers they include analyzed once and shared with
+    // every includer. Its sources stand in for paths in every mode below.
+    IncludeGraph graph;
+    struct GraphScope {
+        ~GraphScope() { include_graph = nullptr; }
+    } graph_scope;
+    if (!compile_commands.empty()) {
+        string error;
+        if (!graph.load_compile_commands(compile_commands, options, error)) {
+            cerr << error << "\n";
+            return 2;
+        }
+    }
+    else if (use_include_graph) {
+        if (paths.empty()) paths.push_back(".");
+        graph.load_paths(paths, options);
+    }
+    if (!compile_commands.empty() || use_include_graph) {
+        paths = graph.sources();
+        include_graph = &graph;
+    }
+
+    // History store: append this run, or query how functions changed
+    if (!history_from.empty()) {
+        if (changed_between.size() == 2) return print_class_changes(history_from, changed_between[0], changed_between[1]);
+        if (!history_function.empty()) return print_function_history(history_from, history_function);
+        cerr << "--history needs --function NAME or --changed FROM TO\n";
+        return 1;
+    }
+    if (!history_to.empty()) {
+        if (commit.empty() && run_command("git rev-parse HEAD 2>" NULL_DEVICE, commit)) {
+            while (!commit.empty() && isspace(static_cast<unsigned char>(commit.back()))) commit.pop_back();
+        }
+        if (commit.empty()) {
+            cerr << "--append-history needs --commit ID outside a git checkout\n";
+            return 1;
+        }
+        if (paths.empty()) paths.push_back(".");
+        if (!append_history(history_to, commit, paths, options)) {
+            cerr << "Cannot append to history " << history_to << "\n";
+            return 2;
+        }
+        return 0;
+    }
+
+    // Results index: write one for paths, or answer a query from one
+    if (!index_from.empty()) return run_index_query(index_from, query);
+    if (!index_to.empty()) {
+        if (paths.empty()) paths.push_back(".");
+        if (!write_index(index_to, paths, options)) {
+            cerr << "Cannot write index " << index_to << "\n";
+            return 2;
+        }
+        return 0;
+    }
+
+    // Baseline modes: record every function's cost, or compare against a record
+    if (!write_baseline_to.empty() || !baseline_from.empty()) {
+        if (paths.empty()) paths.push_back(".");
+        vector<BaselineEntry> current = analyze_baseline(paths, options);
+        if (!write_baseline_to.empty()) {
+            if (!write_baseline(write_baseline_to, current)) {
+                cerr << "Cannot write baseline " << write_baseline_to << "\n";
+                return 2;
+            }
+            cout << "Wrote " << current.size() << " functions to " << write_baseline_to << "\n";
+            return 0;
+        }
+        vector<BaselineEntry> baseline;
+        if (!read_baseline(baseline_from, baseline)) {
+            cerr << "Cannot read baseline " << baseline_from << "\n";
+            return 2;
+        }
+        return compare_baseline(baseline, current);
+    }
+
+    // Repository mode: rank the hottest functions and loops under paths, or
+    // write every file's results in a machine-readable format
+    if (!paths.empty() && format != OutputFormat::TEXT) return run_formatted_report(paths, format, options);
+    if (!paths.empty()) return run_hotspot_report(paths, top, options);
+
+    if (format == OutputFormat::TEXT) {
+        cout << BOLD << CYAN << "C++ Time Complexity Analyzer" << RESET << "\n";
+        cout << BOLD << "Enter your code (type 'END' on a new line to finish):" << RESET << "\n\n";
+    }
+
+    // Read input code
+    vector<string> code;
+    string line;
+    while (getline(cin, line) && line != "END") {
+        code.push_back(line);
+    }
+
+    // Analyze and display results
+    ComplexityAnalyzer analyzer(code, options);
+    auto results = analyzer.analyze();
+    if (format != OutputFormat::TEXT) {
+        FormattedReport report(format, cout);
+        string part;
+        write_file_results(format, "<stdin>", analyzer, results, part);
+        report.add(part);
+        report.finish();
+        return 0;
+    }
+    print_exponential_warnings(analyzer.get_functions());
+    print_results(results);
+    print_findings(analyzer.get_findings());
+    print_function_summaries(analyzer.get_summaries(), analyzer.get_functions(), results);
+    print_final_complexity(analyzer.overall(), analyzer.overall_space_peak());
+
+    return 0;
+}
+
+// Daemon wire format. A request is a count followed by that many strings
+// (the client's working directory, then its arguments), each a 32-bit
+// little-endian length and bytes; the client's standard input follows
+// until it shuts down its side. The reply is a sequence of frames: a
+// channel byte (1 stdout, 2 stderr, 0 exit), a 32-bit length and the data,
+// ending with the exit frame carrying the 32-bit exit code.
+enum class Channel : unsigned char { EXIT = 0, OUT = 1, ERR = 2 };
+
+static bool send_all(socket_handle fd, const char* data, size_t size) {
+    while (size > 0) {
+        auto sent = send(fd, data, static_cast<int>(min<size_t>(size, 1 << 20)), 0);
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+static void put_u32(string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) out += static_cast<char>((value >> shift) & 0xFF);
+}
+
+static bool send_frame(socket_handle fd, Channel channel, const char* data, size_t size) {
+    string header(1, static_cast<char>(channel));
+    put_u32(header, static_cast<uint32_t>(size));
+    return send_all(fd, header.data(), header.size()) && send_all(fd, data, size);
+}
+
+// Reads what the peer sends, for use as a request or as std::cin
+class SocketReadBuffer : public streambuf {
+    socket_handle fd;
+    char buffer[1 << 16];
+
+protected:
+    int_type underflow() override {
+        auto got = recv(fd, buffer, sizeof(buffer), 0);
+        if (got <= 0) return traits_type::eof();
+        setg(buffer, buffer, buffer + got);
+        return traits_type::to_int_type(buffer[0]);
+    }
+
+public:
+    explicit SocketReadBuffer(socket_handle socket) : fd(socket) {}
+};
+
+// Sends everything written to it as frames on one channel, for use as
+// std::cout or std::cerr
+class SocketFrameBuffer : public streambuf {
+    socket_handle fd;
+    Channel channel;
+    char buffer[1 << 16];
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (sync() != 0) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        setp(buffer, buffer + sizeof(buffer));
+        return size == 0 || send_frame(fd, channel, buffer, size) ? 0 : -1;
+    }
+
+public:
+    SocketFrameBuffer(socket_handle socket, Channel ch) : fd(socket), channel(ch) { setp(buffer, buffer + sizeof(buffer)); }
+};
+
+static bool read_u32(istream& in, uint32_t& value) {
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), 4)) return false;
+    value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    return true;
+}
+
+static bool make_socket_address(const string& path, sockaddr_un& address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    copy(path.begin(), path.end(), address.sun_path);
+    return true;
+}
+
+// Answer one request: run its command line in the client's directory with
+// the standard streams connected to the socket
+static void serve_request(socket_handle fd, const string& program) {
+    SocketReadBuffer input(fd);
+    istream request(&input);
+    uint32_t count = 0;
+    vector<string> fields;
+    if (!read_u32(request, count) || count == 0 || count > 4096) return;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t size = 0;
+        if (!read_u32(request, size) || size > (1u << 20)) return;
+        string field(size, '\0');
+        if (!request.read(&field[0], size)) return;
+        fields.push_back(move(field));
+    }
+
+    SocketFrameBuffer out(fd, Channel::OUT), err(fd, Channel::ERR);
+    streambuf* saved_in = cin.rdbuf(&input);
+    streambuf* saved_out = cout.rdbuf(&out);
+    streambuf* saved_err = cerr.rdbuf(&err);
+    cin.clear();
+    int code = 2;
+    error_code error;
+    filesystem::current_path(fields[0], error);
+    if (error) cerr << "Cannot enter " << fields[0] << "\n";
+    else {
+        try {
+            code = run_cli(program, vector<string>(fields.begin() + 1, fields.end()));
+        }
+        catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+        }
+    }
+    cout.flush();
+    cerr.flush();
+    cin.rdbuf(saved_in);
+    cout.rdbuf(saved_out);
+    cerr.rdbuf(saved_err);
+    string exit_code;
+    put_u32(exit_code, static_cast<uint32_t>(code));
+    send_frame(fd, Channel::EXIT, exit_code.data(), exit_code.size());
+}
+
+// Bound how long a client may leave the daemon waiting on a read or a
+// write, so one that holds its input open cannot stall the clients queued
+// behind it
+static void set_socket_timeouts(socket_handle fd, int seconds) {
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(seconds) * 1000;
+#else
+    timeval timeout{ seconds, 0 };
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// Serve requests on a Unix domain socket until killed. Requests are answered
+// one at a time, each on the usual worker pool; compiled matchers, the
+// locale and the analyses of unchanged files stay warm between them. They
+// cannot overlap, since a request runs in its client's working directory
+// with the standard streams connected to it, so a client idle for longer
+// than client_timeout seconds is treated as having closed its input.
+static int run_server(const string& path, const string& program) {
+    const int client_timeout = 10;
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 2;
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    sockaddr_un address;
+    socket_handle listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET || !make_socket_address(path, address)) {
+        cerr << "Cannot create socket " << path << "\n";
+        return 2;
+    }
+    remove(path.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        cerr << "Cannot listen on " << path << "\n";
+        close_socket(listener);
+        return 2;
+    }
+    AnalysisCache cache;
+    analysis_cache = &cache;
+    cerr << "Serving on " << path << "\n";
+    for (;;) {
+        socket_handle client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) continue;
+        set_socket_timeouts(client, client_timeout);
+        serve_request(client, program);
+        close_socket(client);
+    }
+}
+
+// Forward a command line to a daemon and relay its output and exit code.
+// Standard input is copied to the daemon on a separate thread, so commands
+// that never read it finish without waiting for end of input.
+static int run_client(const string& path, const vector<string>& args) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 2;
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    sockaddr_un address;
+    socket_handle fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET || !make_socket_address(path, address) ||
+        connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "Cannot connect to " << path << "\n";
+        return 2;
+    }
+    vector<string> fields = { filesystem::current_path().string() };
+    fields.insert(fields.end(), args.begin(), args.end());
+    string request;
+    put_u32(request, static_cast<uint32_t>(fields.size()));
+    for (const string& field : fields) {
+        put_u32(request, static_cast<uint32_t>(field.size()));
+        request += field;
+    }
+    if (!send_all(fd, request.data(), request.size())) {
+        cerr << "Cannot send request to " << path << "\n";
+        return 2;
+    }
+    thread([fd] {
+        char buffer[1 << 16];
+        for (;;) {
+            auto got = read_stdin(buffer, sizeof(buffer));
+            if (got <= 0 || !send_all(fd, buffer, static_cast<size_t>(got))) break;
+        }
+        shutdown(fd, SHUT_WR);
+    }).detach();
+
+    SocketReadBuffer input(fd);
+    istream reply(&input);
+    for (;;) {
+        char channel;
+        uint32_t size = 0;
+        if (!reply.get(channel) || !read_u32(reply, size)) break;
+        string data(size, '\0');
+        if (size > 0 && !reply.read(&data[0], size)) break;
+        if (static_cast<Channel>(channel) == Channel::EXIT && size == 4) {
+            cout.flush();
+            cerr.flush();
+            return static_cast<int>(static_cast<unsigned char>(data[0]) | static_cast<unsigned char>(data[1]) << 8 |
+                static_cast<unsigned char>(data[2]) << 16 | static_cast<unsigned char>(data[3]) << 24);
+        }
+        (static_cast<Channel>(channel) == Channel::ERR ? cerr : cout).write(data.data(), data.size());
+    }
+    cerr << "Connection to " << path << " closed\n";
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+
+    // Set locale for consistent output
+    ios_base::sync_with_stdio(false);
+    locale::global(locale(""));
+    cout.imbue(locale());
+
+    if (args.size() >= 2 && args[0] == "--serve") return run_server(args[1], argv[0]);
+    if (args.size() >= 2 && args[0] == "--connect") return run_client(args[1], vector<string>(args.begin() + 2, args.end()));
+    return run_cli(argv[0], args);
+}